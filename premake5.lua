@@ -17,13 +17,231 @@ project "hasl"
 		"src/**.cpp"
 	}
 
+	includedirs
+	{
+		"src"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+project "sasm_mine"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++latest"
+	staticruntime "on"
+	flags "MultiProcessorCompile"
+
+	targetdir("bin/" .. outputdir)
+	objdir("bin-int/" .. outputdir)
+
+	files
+	{
+		"tools/sasm_mine/**.cpp"
+	}
+
+	includedirs
+	{
+		"src"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+project "sasm_aot"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++latest"
+	staticruntime "on"
+	flags "MultiProcessorCompile"
+
+	targetdir("bin/" .. outputdir)
+	objdir("bin-int/" .. outputdir)
+
+	files
+	{
+		"tools/sasm_aot/**.cpp"
+	}
+
+	includedirs
+	{
+		"src"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+project "sasm_bench"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++latest"
+	staticruntime "on"
+	flags "MultiProcessorCompile"
+
+	targetdir("bin/" .. outputdir)
+	objdir("bin-int/" .. outputdir)
+
+	files
+	{
+		"tools/sasm_bench/**.cpp"
+	}
+
+	includedirs
+	{
+		"src"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+project "sasm_world"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++latest"
+	staticruntime "on"
+	flags "MultiProcessorCompile"
+
+	targetdir("bin/" .. outputdir)
+	objdir("bin-int/" .. outputdir)
+
+	files
+	{
+		"tools/sasm_world/**.cpp"
+	}
+
+	includedirs
+	{
+		"src"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+project "haslc"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++latest"
+	staticruntime "on"
+	flags "MultiProcessorCompile"
+
+	targetdir("bin/" .. outputdir)
+	objdir("bin-int/" .. outputdir)
+
+	files
+	{
+		"tools/haslc/**.cpp"
+	}
+
+	includedirs
+	{
+		"src"
+	}
+
+	filter "system:windows"
+		systemversion "latest"
+
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+		links { "pthread" }
+
+	filter "configurations:Debug"
+		runtime "Debug"
+		symbols "on"
+		
+	filter "configurations:Release"
+		runtime "Release"
+		optimize "on"
+
+project "sasm_verify"
+	kind "ConsoleApp"
+	language "C++"
+	cppdialect "C++latest"
+	staticruntime "on"
+	flags "MultiProcessorCompile"
+
+	targetdir("bin/" .. outputdir)
+	objdir("bin-int/" .. outputdir)
+
+	files
+	{
+		"tools/sasm_verify/**.cpp"
+	}
+
+	includedirs
+	{
+		"src"
+	}
+
 	filter "system:windows"
 		systemversion "latest"
 
+	filter "system:linux"
+		buildoptions { "-fno-strict-aliasing" }
+		links { "pthread" }
+
 	filter "configurations:Debug"
 		runtime "Debug"
 		symbols "on"
 		
 	filter "configurations:Release"
 		runtime "Release"
-		optimize "on"
\ No newline at end of file
+		optimize "on"
@@ -3,14 +3,30 @@
 #include "hasl/core.h"
 
 #include "hasl/util/functions.h"
+#include "hasl/util/simd.h"
 #include "hasl/util/vec.h"
 
+#include "hasl/sasm/aot.h"
+#include "hasl/sasm/archive.h"
 #include "hasl/sasm/assembler.h"
+#include "hasl/sasm/bytecode.h"
 #include "hasl/sasm/command.h"
+#include "hasl/sasm/context.h"
 #include "hasl/sasm/constants.h"
 #include "hasl/sasm/deserialize.h"
+#include "hasl/sasm/executor.h"
+#include "hasl/sasm/jit.h"
+#include "hasl/sasm/lanes.h"
+#include "hasl/sasm/lexer.h"
+#include "hasl/sasm/linker.h"
+#include "hasl/sasm/profiler.h"
+#include "hasl/sasm/program.h"
 #include "hasl/sasm/registers.h"
+#include "hasl/sasm/scheduler.h"
 #include "hasl/sasm/script.h"
+#include "hasl/sasm/script_cache.h"
 #include "hasl/sasm/script_runtime.h"
 #include "hasl/sasm/scriptable.h"
+#include "hasl/sasm/tracer.h"
+#include "hasl/sasm/verifier.h"
 #include "hasl/sasm/vm.h"
\ No newline at end of file
@@ -4,4 +4,45 @@
 #define HASL_DCM(x) \
 	x(const x& other) = delete; \
 	x(x&& other) = delete;
-#define HASL_ASSERT(x, s) if(!(x)) { printf("HASL error: %s\n", s); __debugbreak(); }
\ No newline at end of file
+#define HASL_ASSERT(x, s) if(!(x)) { printf("HASL error: %s\n", s); HASL_DEBUGBREAK(); }
+#ifdef _MSC_VER
+#define HASL_DEBUGBREAK() __debugbreak()
+#else
+#define HASL_DEBUGBREAK() raise(SIGTRAP)
+#endif
+// for small helpers in hot loops that the compiler won't inline on its own
+#ifdef _MSC_VER
+#define HASL_INLINE __forceinline
+#else
+#define HASL_INLINE inline __attribute__((always_inline))
+#endif
+// labels as values (computed goto) are a GCC/Clang extension
+#ifndef HASL_COMPUTED_GOTO
+#if defined(__GNUC__) || defined(__clang__)
+#define HASL_COMPUTED_GOTO 1
+#else
+#define HASL_COMPUTED_GOTO 0
+#endif
+#endif
+// native code generation (see sasm/jit.h) only targets x86-64
+#ifndef HASL_JIT
+#if defined(__x86_64__) || defined(_M_X64)
+#define HASL_JIT 1
+#else
+#define HASL_JIT 0
+#endif
+#endif
+// packed math for vec<float> (see util/simd.h) with SSE2 (x64) or NEON (arm64) intrinsics. it's only on by default for MSVC: GCC and
+// Clang already pack the scalar fallback, and vectorize loops over arrays of vecs four at a time, which intrinsics on a single pair prevent
+#ifndef HASL_SIMD
+#if defined(_MSC_VER) && (defined(_M_X64) || defined(_M_ARM64))
+#define HASL_SIMD 1
+#else
+#define HASL_SIMD 0
+#endif
+#endif
+// vector math gives bitwise identical results with and without HASL_SIMD (and on every platform), at the cost of a slower normalize.
+// the compiler mustn't contract multiplies and adds into FMAs either (-ffp-contract=off on GCC and Clang, /fp:precise on MSVC)
+#ifndef HASL_STRICT_FP
+#define HASL_STRICT_FP 0
+#endif
@@ -0,0 +1,99 @@
+#pragma once
+#include "pch.h"
+#include "vm.h"
+
+namespace hasl::sasm
+{
+	// scripts compiled ahead of time to C++ by tools/sasm_aot. each generated translation unit registers its scripts here (by the hash of
+	// their instructions) when it's linked in, and vm::run calls the compiled version of any script that has one instead of interpreting it.
+	// compile the generated files into the executable itself: a linker may drop them from a static library, since nothing references them.
+	template<size_t STACK, size_t RAM>
+	class aot
+	{
+	public:
+		// state of the script being run, passed to compiled scripts
+		struct frame
+		{
+			vm<STACK, RAM>* machine;
+			script<STACK, RAM>* s;
+			script_runtime* rt;
+			registers* regs;
+			// instructions left before the script is preempted
+			int64_t budget;
+		};
+		// a compiled script, which starts at the vm's program counter and leaves it where the interpreter would have
+		typedef void(*function)(frame&);
+		// registers a compiled script when the generated translation unit is initialized
+		struct registration
+		{
+			registration(uint64_t hash, function fn)
+			{
+				registry()[hash] = fn;
+			}
+		};
+	public:
+		// compiled version of p, or nullptr if there isn't one
+		static function find(const program<STACK, RAM>& p)
+		{
+			if (registry().empty())
+				return nullptr;
+			const auto& it = registry().find(hash(p));
+			return it == registry().end() ? nullptr : it->second;
+		}
+		// FNV-1a of the entry point and the encoded instructions (handlers are left out, so fusing a script doesn't change its hash)
+		static uint64_t hash(const program<STACK, RAM>& p)
+		{
+			uint64_t h = fnv1a(HASL_CAST(uint64_t, p.get_entry_point()), fnv1a_basis);
+			for (const args& a : p.get_instructions())
+			{
+				h = fnv1a(a.encode(), h);
+				h = fnv1a(HASL_PUN(uint64_t, a.ii), h);
+			}
+			return h;
+		}
+	public:
+		// the handler compiled code calls for a: its own, unless it's a superinstruction (see vm::fuse), which is compiled as the first of the
+		// instructions it stands for, since the others are still in place after it and each is compiled on its own
+		static uint16_t handler(const args& a)
+		{
+			const uint16_t form = vm<STACK, RAM>::quicken(a);
+			return vm<STACK, RAM>::checked(a.handler) == form ? a.handler : form;
+		}
+		// everything below is used by generated code
+		static size_t& pc(frame& f)
+		{
+			return f.s->m_context.pc;
+		}
+		static bool aborted(const frame& f)
+		{
+			return f.s->m_context.abort;
+		}
+		// charges a branch back to target for the length of the loop, returns true (leaving the script to resume at target) once the budget
+		// runs out
+		static bool charge(frame& f, size_t length, size_t target)
+		{
+			if ((f.budget -= HASL_CAST(int64_t, length)) > 0)
+				return false;
+			pc(f) = target;
+			return true;
+		}
+#define X(name) \
+		static void name(frame& f, const args& a) \
+		{ \
+			f.machine->name(f.s, a, *f.rt); \
+		}
+#define U(name) X(name##_u)
+		HASL_SASM_HANDLERS(X)
+		HASL_SASM_QUICK_HANDLERS(X)
+		HASL_SASM_UNCHECKED_HANDLERS(U)
+#undef U
+#undef X
+	private:
+		// constructed on first use, since registrations run during static initialization
+		static std::unordered_map<uint64_t, function>& registry()
+		{
+			static std::unordered_map<uint64_t, function> functions;
+			return functions;
+		}
+	};
+}
@@ -0,0 +1,211 @@
+#pragma once
+#include "pch.h"
+#include "bytecode.h"
+#include "deserialize.h"
+
+namespace hasl::sasm
+{
+	// serialized scripts packed into one file under their names, with a hash index to find each by name in constant time. the file is mapped
+	// once, and the scripts loaded from it run from the mapping (see deserialize), which stays open while any of them is alive. archives are
+	// written in the byte order of the machine that writes them, and only read on machines with the same one
+	class archive
+	{
+	public:
+		// maps the archive at fp (check with valid)
+		archive(const char* const fp) :
+			m_fp(fp),
+			m_file(std::make_shared<mapped_file>(fp)),
+			m_count(0),
+			m_entries(nullptr),
+			m_slots(nullptr),
+			m_slot_count(0)
+		{
+			if (!m_file->data())
+			{
+				printf("Error opening sasm archive '%s'\n", fp);
+				return;
+			}
+
+			header h;
+			const size_t size = m_file->size();
+			if (size >= sizeof(h))
+				memcpy(&h, m_file->data(), sizeof(h));
+			if (size < sizeof(h) || memcmp(h.magic, s_magic, sizeof(h.magic)) != 0)
+			{
+				printf("Error reading sasm archive '%s'\n", fp);
+				return;
+			}
+			if (h.endian != bytecode_header::s_endian || h.version != s_version || h.size != sizeof(h))
+			{
+				printf("Unsupported sasm archive version %u in '%s'\n", HASL_CAST(unsigned, h.version), fp);
+				return;
+			}
+			// the slot count is a power of two, so a hash is masked down to one
+			const bool fits = h.entries_offset <= size && h.count <= (size - h.entries_offset) / sizeof(entry) &&
+				h.slots_offset <= size && h.slot_count <= (size - h.slots_offset) / sizeof(uint64_t) &&
+				h.slot_count && (h.slot_count & (h.slot_count - 1)) == 0 &&
+				h.entries_offset % alignof(entry) == 0 && h.slots_offset % alignof(uint64_t) == 0;
+			if (!fits)
+			{
+				printf("Error reading sasm archive '%s'\n", fp);
+				return;
+			}
+
+			const entry* const entries = reinterpret_cast<const entry*>(m_file->data() + h.entries_offset);
+			for (size_t i = 0; i < h.count; i++)
+			{
+				const entry& e = entries[i];
+				if (e.name_offset > size || e.name_size > size - e.name_offset || e.offset > size || e.size > size - e.offset)
+				{
+					printf("Error reading sasm archive '%s'\n", fp);
+					return;
+				}
+			}
+			m_count = h.count;
+			m_entries = entries;
+			m_slots = reinterpret_cast<const uint64_t*>(m_file->data() + h.slots_offset);
+			m_slot_count = h.slot_count;
+		}
+		HASL_DCM(archive);
+	public:
+		// packs scripts into an archive at fp under their names (which have to be unique), returns false if it couldn't be written
+		template<size_t STACK, size_t RAM>
+		static bool write(const char* const fp, const std::vector<std::pair<std::string, const script<STACK, RAM>*>>& scripts)
+		{
+			header h = {};
+			memcpy(h.magic, s_magic, sizeof(h.magic));
+			h.version = s_version;
+			h.endian = bytecode_header::s_endian;
+			h.size = sizeof(h);
+			h.count = scripts.size();
+			h.slot_count = 1;
+			// at most half full, so probes stay short
+			while (h.slot_count < scripts.size() * 2)
+				h.slot_count *= 2;
+
+			std::string names, blobs;
+			std::vector<entry> entries;
+			std::vector<uint64_t> slots(h.slot_count, 0);
+			for (const auto& [name, s] : scripts)
+			{
+				const uint64_t key = fnv1a(name.data(), name.size());
+				uint64_t slot = key & (h.slot_count - 1);
+				for (; slots[slot]; slot = (slot + 1) & (h.slot_count - 1))
+				{
+					if (entry_name(entries[slots[slot] - 1], names) == name)
+					{
+						printf("Script '%s' is in sasm archive '%s' twice\n", name.c_str(), fp);
+						return false;
+					}
+				}
+				slots[slot] = entries.size() + 1;
+
+				std::ostringstream blob;
+				s->serialize(blob);
+				// each script starts on a cache line, which keeps its instructions aligned
+				blobs.resize((blobs.size() + s_alignment - 1) / s_alignment * s_alignment, 0);
+				entries.push_back({ key, names.size(), name.size(), blobs.size(), blob.str().size() });
+				names += name;
+				blobs += blob.str();
+			}
+
+			h.entries_offset = sizeof(h);
+			h.slots_offset = h.entries_offset + entries.size() * sizeof(entry);
+			const uint64_t names_offset = h.slots_offset + slots.size() * sizeof(uint64_t);
+			const uint64_t blobs_offset = (names_offset + names.size() + s_alignment - 1) / s_alignment * s_alignment;
+			for (entry& e : entries)
+			{
+				e.name_offset += names_offset;
+				e.offset += blobs_offset;
+			}
+
+			std::ofstream out(fp, std::ios::binary);
+			if (!out.is_open())
+			{
+				printf("Error opening sasm archive '%s' for writing\n", fp);
+				return false;
+			}
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+			out.write(reinterpret_cast<const char*>(entries.data()), entries.size() * sizeof(entry));
+			out.write(reinterpret_cast<const char*>(slots.data()), slots.size() * sizeof(uint64_t));
+			out.write(names.data(), names.size());
+			out << std::string(blobs_offset - names_offset - names.size(), '\0') << blobs;
+			return out.good();
+		}
+		bool valid() const
+		{
+			return m_entries != nullptr;
+		}
+		// number of scripts in the archive
+		size_t size() const
+		{
+			return m_count;
+		}
+		// name of the i-th script, in the order they were written
+		std::string name(size_t i) const
+		{
+			return std::string(reinterpret_cast<const char*>(m_file->data() + m_entries[i].name_offset), m_entries[i].name_size);
+		}
+		bool contains(const std::string& name) const
+		{
+			return find(name) != nullptr;
+		}
+		// loads the script called name (see deserialize), which its program is named for, or returns nullptr if there's no such script
+		template<typename T, size_t STACK = T::s_stack, size_t RAM = T::s_ram>
+		T* load(const std::string& name, std::type_identity_t<vm<STACK, RAM>>* const vm) const
+		{
+			const entry* const e = find(name);
+			if (!e)
+			{
+				printf("No script '%s' in sasm archive '%s'\n", name.c_str(), m_fp.c_str());
+				return nullptr;
+			}
+			return deserialize<T>(m_file, e->offset, e->size, vm, (m_fp + ":" + name).c_str(), name.c_str());
+		}
+	private:
+		struct header
+		{
+			char magic[4];
+			uint16_t version, endian;
+			uint64_t size, count, entries_offset, slots_offset, slot_count;
+		};
+		// one script, and where its name and serialized form are (offsets are from the start of the file)
+		struct entry
+		{
+			uint64_t hash, name_offset, name_size, offset, size;
+		};
+		constexpr static char s_magic[4] = { 'S', 'A', 'S', 'A' };
+		constexpr static uint16_t s_version = 1;
+		constexpr static size_t s_alignment = 64;
+	private:
+		std::string m_fp;
+		std::shared_ptr<mapped_file> m_file;
+		size_t m_count;
+		const entry* m_entries;
+		// index + 1 of the entry in each slot of the hash table (0 is empty)
+		const uint64_t* m_slots;
+		size_t m_slot_count;
+	private:
+		static std::string entry_name(const entry& e, const std::string& names)
+		{
+			return names.substr(e.name_offset, e.name_size);
+		}
+		const entry* find(const std::string& name) const
+		{
+			if (!valid())
+				return nullptr;
+			const uint64_t key = fnv1a(name.data(), name.size());
+			for (size_t slot = key & (m_slot_count - 1), probes = 0; probes < m_slot_count && m_slots[slot]; slot = (slot + 1) & (m_slot_count - 1),
+				probes++)
+			{
+				const uint64_t index = m_slots[slot] - 1;
+				if (index >= m_count)
+					return nullptr;
+				const entry& e = m_entries[index];
+				if (e.hash == key && e.name_size == name.size() && memcmp(m_file->data() + e.name_offset, name.data(), name.size()) == 0)
+					return &e;
+			}
+			return nullptr;
+		}
+	};
+}
@@ -1,11 +1,13 @@
 #pragma once
 #include "pch.h"
 #include "command.h"
+#include "bytecode.h"
+#include "lexer.h"
 
 namespace hasl::sasm
 {
 	template<size_t, size_t>
-	class script;
+	class program;
 	template<size_t, size_t>
 	class vm;
 
@@ -13,455 +15,360 @@ namespace hasl::sasm
 	class assembler
 	{
 	public:
-		assembler(const char* fp, script<STACK, RAM>* const s, vm<STACK, RAM>* const vm) :
-			m_line(0),
+		assembler(const char* fp, program<STACK, RAM>* const p) :
 			m_last_mem_write(RAM),
 			m_filepath(fp),
-			m_file(fp),
 			m_abort(false),
-			m_script(s),
-			m_vm(vm)
+			m_program(p)
 		{
-			if (!m_file.is_open())
+			vm<STACK, RAM>::initialize();
+			std::ifstream file(fp, std::ios::binary);
+			if (!file.is_open())
 			{
 				printf("Error opening script file '%s'\n", fp);
 				m_abort = true;
+				return;
 			}
+			// the whole file is read at once, and the lexer's tokens point into it
+			file.seekg(0, std::ios::end);
+			m_source.resize(HASL_CAST(size_t, file.tellg()));
+			file.seekg(0, std::ios::beg);
+			file.read(m_source.data(), m_source.size());
 		}
 		HASL_DCM(assembler);
 	public:
 		bool assemble()
 		{
 			// read the file
-			std::string line;
-			while (!m_abort && next_line(&line))
-			{
-				m_line++;
-
-				line = string_trim(line);
-				if (line.empty())
-					continue;
-
+			lexer lex(m_source);
+			lexer::line line;
+			while (!m_abort && lex.next(&line))
 				parse_line(line);
-			}
 
 			// resolve label references
+			symbol_table& symbols = m_program->m_symbols;
 			if (!m_abort)
 			{
-				for (const auto& ref : m_references)
+				for (const reference& ref : m_references)
 				{
-					const auto& it = m_labels.find(ref.second);
+					const auto& it = m_labels.find(ref.label.text);
+					// an imported label is filled in by linker, and until then it's out of range so the script can't branch to it
+					if (it == m_labels.end() && m_imports.contains(ref.label.text))
+					{
+						symbols.imports.emplace_back(ref.index, ref.label.text);
+						m_program->m_owned[ref.index].ii = -1;
+						continue;
+					}
 					// a non-existent label was referenced
 					if (it == m_labels.end())
 					{
-						err(ref.first, "Unresolved label '%s'", ref.second);
+						err(ref.line, ref.label.column, "Unresolved label '%.*s'", HASL_CAST(int, ref.label.text.size()), ref.label.text.data());
 						break;
 					}
 					// label value is always in this spot
-					m_script->m_instructions[ref.first].ii[0] = it->second;
+					m_program->m_owned[ref.index].ii = it->second;
+					symbols.relocations.push_back({ ref.index, relocation::CODE });
 				}
 			}
+			for (const auto& [label, line] : m_exports)
+			{
+				const auto& it = m_labels.find(label.text);
+				if (it == m_labels.end())
+				{
+					err(line, label.column, "Exported label '%.*s' is not defined", HASL_CAST(int, label.text.size()), label.text.data());
+					break;
+				}
+				symbols.exports.emplace_back(it->second, label.text);
+			}
+			std::sort(symbols.relocations.begin(), symbols.relocations.end(), [](const relocation& a, const relocation& b) { return a.index < b.index; });
 
 			// if a "main" label is provided, use it as the entry point
 			const auto& it = m_labels.find(c::entry_point_token);
 			if (it != m_labels.end())
-				m_script->m_entry_point = it->second;
+				m_program->m_entry_point = it->second;
+
+			// kept by the program, for tools that name places in its code (see profiler.h)
+			for (const auto& label : m_labels)
+				m_program->m_labels.emplace_back(label.second, label.first);
+			std::sort(m_program->m_labels.begin(), m_program->m_labels.end());
+			// and the string literals, laid out as they'll be in RAM: each one below the one before it
+			m_program->m_data.address = m_last_mem_write;
+			m_program->m_data.bytes.reserve(RAM - m_last_mem_write);
+			for (auto it = m_strings.rbegin(); it != m_strings.rend(); it++)
+			{
+				m_program->m_data.bytes.insert(m_program->m_data.bytes.end(), it->begin(), it->end());
+				m_program->m_data.bytes.push_back(0);
+			}
 
 			return !m_abort;
 		}
 	private:
-		size_t m_line, m_last_mem_write;
-		std::unordered_map<std::string, size_t> m_labels;
-		std::unordered_map<size_t, std::string> m_references;
-		std::string m_filepath;
-		std::ifstream m_file;
-		bool m_abort;
-		script<STACK, RAM>* m_script;
-		vm<STACK, RAM>* m_vm;
-	private:
-		struct reg_indices
+		// an argument that names a label, whose index is filled in once every label is known
+		struct reference
 		{
-			size_t i[3] = { 0 };
+			size_t index, line;
+			lexer::token label;
 		};
-	private:
-		static uint64_t serialize_args(const args& a, const reg_indices& r)
+		// an argument's type, and its bits in an integer (a float's are punned, and flagged)
+		struct operand
 		{
-			return s_serialization_functions[s_instruction_groups[a.opcode]](a, r);
-		}
-		static uint64_t serialize_base(const args& a)
-		{
-			return HASL_CAST(uint64_t, a.opcode) << 56;
-		}
-		// 7: opcode
-		// 6: src reg 1
-		// 5: dst reg
-		// 4: flags for 3-0
-		//	1 if int reg
-		//	2 if float reg
-		//	3 if vec reg
-		//  4 if float immediate
-		//  5 if int immediate
-		// 3-0: src reg 2 / immediate
-		static uint64_t serialize23r1i(const args& a, const reg_indices& r, bool float_immediate)
-		{
-			uint64_t i = serialize_base(a);
-			if (a.i[0])
-				i |= 0x40000000000000 | (r.i[0] << 48);
-			else if (a.f[0])
-				i |= 0x80000000000000 | (r.i[0] << 48);
-			else if (a.v[0])
-				i |= 0xc0000000000000 | (r.i[0] << 48);
-
-			if (a.i[2])
-				i |= 0x400000000000 | (r.i[2] << 40);
-			else if (a.f[2])
-				i |= 0x800000000000 | (r.i[2] << 40);
-			else if (a.v[2])
-				i |= 0xc00000000000 | (r.i[2] << 40);
-
-			if (a.i[1])
-				i |= 0x100000000 | r.i[1];
-			else if (a.f[1])
-				i |= 0x200000000 | r.i[1];
-			else if (a.v[1])
-				i |= 0x300000000 | r.i[1];
-			else
-			{
-				if (float_immediate)
-					i |= 0x400000000 | HASL_PUN(uint64_t, a.f);
-				else
-					i |= 0x500000000 | a.ii[0];
-			}
-
-			return i;
-		}
+			arg_type type;
+			i_t value;
+			bool is_float;
+		};
 	private:
-		bool next_line(std::string* const line)
-		{
-			if (m_file.eof())
-				return false;
-			getline(m_file, *line);
-			return true;
-		}
-		void parse_line(std::string& line)
+		size_t m_last_mem_write;
+		std::string m_source;
+		// names are views into m_source
+		std::unordered_map<std::string_view, size_t> m_labels;
+		std::vector<reference> m_references;
+		// labels named by import, and by export (with the line each was on)
+		std::unordered_set<std::string_view> m_imports;
+		std::vector<std::pair<lexer::token, size_t>> m_exports;
+		// each string literal's text (without quotes), in the order they were written down from the top of RAM
+		std::vector<std::string_view> m_strings;
+		std::string m_filepath;
+		bool m_abort;
+		program<STACK, RAM>* m_program;
+	private:
+		void parse_line(const lexer::line& line)
 		{
-			// separate line into instruction and arguments
-			const size_t space = string_next_space(line);
-			// `line` is already trimmed, so this won't have surrounding whitespace
-			std::string command = line.substr(0, space);
-			// there may be multiple spaces between the command and the args, so we need to trim this
-			std::string args = string_trim(line.substr(space));
-
-			// this line is commented out, ignore it
-			if (command[0] == c::comment_token)
-				return;
-
+			// this line imports or exports a label
+			if (line.command.text == c::import_token || line.command.text == c::export_token)
+				parse_symbol(line);
 			// this line is a label definition
-			if (command.back() == c::label_token)
-				parse_label(command, args);
+			else if (line.command.text.back() == c::label_token)
+				parse_label(line);
 			// this line is an instruction
 			else
-				create(command, args);
+				create(line);
 		}
-		void parse_label(const std::string& cmd, const std::string& args)
+		void parse_label(const lexer::line& line)
 		{
 			// check that label is on its own line
-			const std::string label = cmd.substr(0, cmd.size() - 1);
-			if (!args.empty())
+			const std::string_view label = line.command.text.substr(0, line.command.text.size() - 1);
+			if (!line.rest.empty())
 			{
-				err(m_line, "Label definition '%s' is not on its own line", label.c_str());
+				err(line.number, line.command.column, "Label definition '%.*s' is not on its own line", HASL_CAST(int, label.size()), label.data());
 				return;
 			}
 
 			// check if this label is being redefined
 			const auto& it = m_labels.find(label);
-			if (it != m_labels.end())
+			if (it != m_labels.end() || m_imports.contains(label))
 			{
-				err(m_line, "Label '%s' is defined twice", label.c_str());
+				err(line.number, line.command.column, "Label '%.*s' is defined twice", HASL_CAST(int, label.size()), label.data());
 				return;
 			}
 
 			// add the label
-			m_labels.emplace(label, m_script->m_instructions.size());
+			m_labels.emplace(label, m_program->m_owned.size());
 		}
-		void create(const std::string& command, const std::string& arglist)
+		void parse_symbol(const lexer::line& line)
+		{
+			const bool imported = line.command.text == c::import_token;
+			if (line.count != 1 || !std::isalpha(HASL_CAST(unsigned char, line.args[0].text[0])))
+			{
+				err(line.number, line.command.column, "'%s' expects one label", imported ? c::import_token : c::export_token);
+				return;
+			}
+
+			const lexer::token& label = line.args[0];
+			if (!imported)
+				m_exports.emplace_back(label, line.number);
+			// labels defined here can't be imported too
+			else if (m_labels.contains(label.text))
+				err(line.number, label.column, "Label '%.*s' is defined twice", HASL_CAST(int, label.text.size()), label.text.data());
+			else
+				m_imports.insert(label.text);
+		}
+		void create(const lexer::line& line)
 		{
 			// get info about the given command
 			args args;
+			const std::string_view command = line.command.text;
 			const auto& desc = vm<STACK, RAM>::s_command_descriptions.find(command);
 			if (desc == vm<STACK, RAM>::s_command_descriptions.end())
 			{
-				err(m_line, "Invalid command '%s'", command.c_str());
+				err(line.number, line.command.column, "Invalid command '%.*s'", HASL_CAST(int, command.size()), command.data());
 				return;
 			}
 			args.opcode = desc->second.opcode;
 
 			// check that correct number of args were given
 			const auto& expected = desc->second.args;
-			std::vector<std::string> list = string_split(arglist, hasl::c::list_separator_token);
-			// remove empty args
-			list.erase(std::remove_if(list.begin(), list.end(), [](const std::string& s) { return string_trim(s).size() == 0; }), list.end());
-			if (list.size() != expected.size())
+			if (line.count != expected.size())
 			{
-				err(m_line, "Instruction '%s' expects %zu arguments but %zu were given", desc->first.c_str(), expected.size(), list.size());
+				err(line.number, line.command.column, "Instruction '%s' expects %zu arguments but %zu were given", desc->first.c_str(), expected.size(),
+					line.count);
 				return;
 			}
 
 			// parse each argument
-			size_t imm_count = 0;
-			reg_indices regs;
-			for (size_t i = 0; i < list.size(); i++)
+			for (size_t i = 0; i < line.count; i++)
 			{
+				const lexer::token& arg = line.args[i];
+				const operand result = parse_arg(line.number, arg);
+				if (result.type == arg_type::NONE)
+					return;
 				// check that current arg matches the expected type
-				arg_type cur = get_arg_type(list[i]);
-				if (!(expected[i] & cur))
+				if (!(expected[i] & result.type))
 				{
-					err(m_line, "Invalid argument %u for instruction '%s'", i, desc->first.c_str());
+					err(line.number, arg.column, "Invalid argument %zu for instruction '%s'", i, desc->first.c_str());
 					return;
 				}
 
 				// this argument is a label reference, which must be resolved at the end
-				if (cur == arg_type::L)
+				if (result.type == arg_type::L)
+				{
+					m_references.push_back({ m_program->m_owned.size(), line.number, arg });
 					continue;
-
-				// whatever this argument is, get its bits in an integer
-				auto result = resolve_int(list[i]);
+				}
 
 				// this argument is an immediate
-				if (is_immediate(cur))
+				if (is_immediate(result.type))
 				{
-					// int immediate
-					if (!result.second)
+					// 16-bit int immediate (these can share the immediate with another slot)
+					if (!result.is_float && (expected[i] & arg_type::MIS) != arg_type::NONE)
 					{
-						if(cur == arg_type::MIS && (result.first <= c::small_int_min || result.first >= c::small_int_max))
-							err(m_line, "Invalid 16-bit integer literal %d (must be in [%d, %d])", c::small_int_min, c::small_int_max);
-						
-						args.ii[imm_count++] = result.first;
+						if (result.value < c::small_int_min || result.value > c::small_int_max)
+							err(line.number, arg.column, "Invalid 16-bit integer literal %lld (must be in [%d, %d])", result.value, c::small_int_min,
+								c::small_int_max);
+
+						args.si[i] = HASL_CAST(int16_t, result.value);
 					}
+					// int immediate
+					else if (!result.is_float)
+						args.ii = result.value;
 					// float immediate
 					else
-						args.fi = HASL_PUN(f_t, result.first);
+						args.fi = HASL_PUN(f_t, result.value);
 				}
 				// this argument is a register
 				else
 				{
-					regs.i[i] = result.first;
-					if (cur == arg_type::I)
-						args.i[i] = m_vm->get_int_reg(result.first);
-					else if (cur == arg_type::F)
-						args.f[i] = m_vm->get_float_reg(result.first);
+					if (result.type == arg_type::I)
+						args.set_reg(i, reg_type::I, result.value - c::first_int_reg);
+					else if (result.type == arg_type::F)
+						args.set_reg(i, reg_type::F, result.value - c::first_float_reg);
 					else
-						args.v[i] = m_vm->get_vec_reg(result.first);
+						args.set_reg(i, reg_type::V, result.value - c::first_vec_reg);
 				}
 			}
 
-			m_script->m_instructions.emplace_back(args);
-			m_script->m_byte_code.emplace_back(serialize_args(args, regs));
+			args.handler = vm<STACK, RAM>::quicken(args);
+			m_program->m_owned.emplace_back(args);
 		}
-		arg_type get_arg_type(const std::string& arg)
+		// works out what an argument is and its value in one pass over it. returns arg_type::NONE (having reported why) if it's invalid
+		operand parse_arg(size_t line, const lexer::token& token)
 		{
-			// string literal
-			if (arg[0] == hasl::c::string_token)
-				return arg_type::MS;
-
-			// label reference
-			if (std::isalpha(arg[0]))
-			{
-				m_references.emplace(m_script->m_instructions.size(), arg);
-				return arg_type::L;
-			}
+			const std::string_view arg = token.text;
 
-			// special register
-			const auto& it = c::special_regs.find(arg);
-			if (it != c::special_regs.end())
-				return arg_type::I;
-
-			// register
-			if (arg[0] == c::reg_token)
-			{
-				if (arg.size() != 3)
-					goto get_arg_type_end;
-
-				const char c = arg[1], n = arg[2];
-				if ((c == 'i' && (n >= '0' && n <= '7')) ||
-					((c == 'j' || c == 'k') && (n >= '0' && n <= '3')))
-					return arg_type::I;
-				if ((c == 'f' && (n >= '0' && n <= '7')) ||
-					((c == 'g' || c == 'h') && (n >= '0' && n <= '3')))
-					return arg_type::F;
-				if ((c == 'v' && (n >= '0' && n <= '7')) ||
-					((c == 'w' || c == 'x') && (n >= '0' && n <= '3')))
-					return arg_type::V;
-			}
-
-			// float immediate (must contain a '.')
-			if (arg.find(c::float_token) != std::string::npos)
-				return arg_type::MF;
-			// int immediate
-			if (isdigit(arg[0]) || arg[0] == '-')
-			{
-				int64_t i = parse_int(arg);
-				if (i >= c::small_int_min && i <= c::small_int_max)
-					return arg_type::MI | arg_type::MIS;
-				return arg_type::MI;
-			}
-
-		get_arg_type_end:
-			err(m_line, "Invalid argument '%s'", arg.c_str());
-			return arg_type::NONE;
-		}
-		std::pair<i_t, bool> resolve_int(const std::string& arg)
-		{
 			// string literal
 			if (arg[0] == hasl::c::string_token)
 			{
 				// make sure the last character is also a "
-				if (arg.back() != hasl::c::string_token)
+				if (arg.size() < 2 || arg.back() != hasl::c::string_token)
 				{
-					err(m_line, "String literals must be enclosed in '\"'");
-					return { 0, false };
+					err(line, token.column, "String literals must be enclosed in '\"'");
+					return { arg_type::NONE, 0, false };
 				}
-				// write string into RAM
+				// place string in RAM, with its terminator (it's written there when the script is loaded)
 				const size_t length = arg.size() - 1;
+				if (length > m_last_mem_write)
+				{
+					err(line, token.column, "String literals don't fit in RAM");
+					return { arg_type::NONE, 0, false };
+				}
 				m_last_mem_write = m_last_mem_write - length;
-				for (size_t i = 0; i < length; i++)
-					m_vm->m_memory[m_last_mem_write + i] = (i == length - 1 ? 0 : arg[i + 1]);
-				// return pointer to the string
-				return { HASL_CAST(int64_t, m_last_mem_write), false };
+				m_strings.push_back(arg.substr(1, length - 1));
+				// return pointer to the string, which moves if the script is linked
+				m_program->m_symbols.relocations.push_back({ m_program->m_owned.size(), relocation::DATA });
+				return { arg_type::MS, HASL_CAST(i_t, m_last_mem_write), false };
 			}
 
-			// get special register index from map
+			// label reference
+			if (std::isalpha(HASL_CAST(unsigned char, arg[0])))
+				return { arg_type::L, 0, false };
+
+			// special register
 			const auto& it = c::special_regs.find(arg);
 			if (it != c::special_regs.end())
-				return { it->second, false };
+				return { arg_type::I, HASL_CAST(i_t, it->second), false };
 
-			// $<c><n>
+			// register, $<c><n>
 			if (arg[0] == c::reg_token)
 			{
-				// group base index + number
-				char group = arg[1], n = arg[2] - '0';
-				return { c::reg_offsets.at(group) + n, false };
+				if (arg.size() == 3)
+				{
+					const char group = arg[1], n = arg[2];
+					arg_type type = arg_type::NONE;
+					if ((group == 'i' && (n >= '0' && n <= '7')) ||
+						((group == 'j' || group == 'k') && (n >= '0' && n <= '3')))
+						type = arg_type::I;
+					else if ((group == 'f' && (n >= '0' && n <= '7')) ||
+						((group == 'g' || group == 'h') && (n >= '0' && n <= '3')))
+						type = arg_type::F;
+					else if ((group == 'v' && (n >= '0' && n <= '7')) ||
+						((group == 'w' || group == 'x') && (n >= '0' && n <= '3')))
+						type = arg_type::V;
+					// group base index + number
+					if (type != arg_type::NONE)
+						return { type, HASL_CAST(i_t, c::reg_offsets.at(group) + (n - '0')), false };
+				}
 			}
-
-			// floats are still returned as "ints" but with the flag set
-			if (arg.find('.') != std::string::npos)
+			// float immediate (must contain a '.'), returned as an "int" but with the flag set
+			else if (arg.find(c::float_token) != std::string_view::npos)
+			{
+				const std::string_view digits = arg[0] == '+' ? arg.substr(1) : arg;
+				f_t d = 0;
+				const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), d);
+				if (error == std::errc() && end == digits.data() + digits.size())
+					return { arg_type::MF, HASL_PUN(i_t, d), true };
+			}
+			// int immediate
+			else if (std::isdigit(HASL_CAST(unsigned char, arg[0])) || arg[0] == '-')
 			{
-				f_t d = std::stod(arg);
-				return { HASL_PUN(int64_t, d), true };
+				i_t i = 0;
+				if (parse_int(arg, &i))
+				{
+					if (i >= c::small_int_min && i <= c::small_int_max)
+						return { arg_type::MI | arg_type::MIS, i, false };
+					return { arg_type::MI, i, false };
+				}
 			}
 
-			return { parse_int(arg), false };
+			err(line, token.column, "Invalid argument '%.*s'", HASL_CAST(int, arg.size()), arg.data());
+			return { arg_type::NONE, 0, false };
 		}
-		int64_t parse_int(const std::string& arg)
+		// false if arg isn't a whole int in range
+		static bool parse_int(std::string_view arg, i_t* const value)
 		{
-			// support bin, dec, and hex
+			// support bin, dec, and hex (a sign goes before the prefix)
+			const bool negative = arg[0] == '-';
 			int base = 10;
-			if (arg.find("0x") == 0)
+			if (arg.substr(negative).starts_with("0x"))
 				base = 16;
-			if (arg.find("0b") == 0)
+			if (arg.substr(negative).starts_with("0b"))
 				base = 2;
-			return std::stoll((base != 10 ? arg.substr(2) : arg), nullptr, base);
+			const std::string_view digits = base != 10 ? arg.substr(negative + 2) : arg;
+			if (base != 10 && digits.starts_with('-'))
+				return false;
+
+			const auto [end, error] = std::from_chars(digits.data(), digits.data() + digits.size(), *value, base);
+			if (error != std::errc() || end != digits.data() + digits.size())
+				return false;
+			if (base != 10 && negative)
+				*value = -*value;
+			return true;
 		}
 		template<typename ... ARGS>
-		void err(size_t line, const char* fmt, const ARGS& ... args)
+		void err(size_t line, size_t column, const char* fmt, const ARGS& ... args)
 		{
 			char buf[1024];
-			sprintf_s(buf, "[%s:%llu] %s\n", m_filepath.c_str(), m_line, fmt);
+			snprintf(buf, sizeof(buf), "[%s:%zu:%zu] %s\n", m_filepath.c_str(), line, column, fmt);
 			printf(buf, args...);
 			m_abort = true;
 		}
-	private:
-		constexpr static size_t s_instruction_groups[] =
-		{
-			// math
-			0, 1, 2, 0, 1, 2, 0, 1, 2, 0, 1, 2,
-			// bit
-			0, 0, 0, 0, 3, 0, 0,
-			// trig
-			4, 4, 4, 4, 4, 4,
-			// fn
-			0, 0, 1, 1, 5, 5, 1, 6, 3, 6, 7, 0, 1, 3, 6, 7,
-			// vec
-			8, 5, 5, 8, 7,
-			// mem
-			9, 9, 10, 3, 3, 11, 12, 12, 12, 13, 14,
-			// ctrl
-			15, 16, 15, 17, 17, 17, 17, 18, 18, 26, 26, 19, 19,
-			// debug
-			19, 20, 21, 22,
-			// engine
-			23,
-			// input
-			21, 21, 3, 3, 24,
-			// obj
-			21, 21, 21, 21 ,21, 23, 22, 25
-		};
-		const static inline std::vector<std::function<uint64_t(const args&, const reg_indices&)>> s_serialization_functions =
-		{
-			// I, I_MI, I
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// F, F_MF, F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, true); },
-			// V, F_V_MF
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, true); },
-			// I_MI, I
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// F, F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-
-			// V, F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// F_MF, F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// V, V
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// V, V, F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-
-			// I_F_V
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_F_MI, I
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_F_MF, F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, true); },
-			// I_F_V, I_MI
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_MI, I_F_V
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-
-
-			
-			// I_F_V, I_F_V, L_MI
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_F_V, L_MI
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_F, I_F, L_MI
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// L_MI
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_MI
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-
-
-
-			// F_MF
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, true); },
-			// V
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_MI_MS
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// F
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-			// I_MIS, I_MIS, I
-			[](const args& a, const reg_indices& r)
-			{
-				uint64_t i = serialize_base(a);
-				// TODO
-				return i;
-			},
-
-			// I_MI_MS, I
-			[](const args& a, const reg_indices& r) { return serialize23r1i(a, r, false); },
-		};
 	};
 }
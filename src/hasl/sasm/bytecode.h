@@ -0,0 +1,178 @@
+#pragma once
+#include "pch.h"
+#include "command.h"
+
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+#endif
+
+namespace hasl::sasm
+{
+	// the string literals a script's instructions point to, and where they start in the vm's RAM (the assembler writes them down from the top)
+	struct data_segment
+	{
+		size_t address = 0;
+		std::vector<uint8_t> bytes;
+	};
+	// an instruction whose immediate is an address in its script's own code or string literals, which moves when the script is linked with
+	// others (see linker)
+	struct relocation
+	{
+		enum target_t : uint64_t
+		{
+			CODE, DATA
+		};
+		size_t index;
+		target_t target;
+	};
+	// what a script needs to be linked: its relocations, the labels it imports (by the instruction that uses each), and the labels it
+	// exports (by instruction index). empty for a script that has been linked
+	struct symbol_table
+	{
+		std::vector<relocation> relocations;
+		std::vector<std::pair<size_t, std::string>> imports, exports;
+	};
+
+
+
+	// start of a serialized script (see script::serialize and deserialize), followed by its sections wherever the header says they are.
+	// instructions are stored the way they're run (decoded, with the handlers the vm picked for them), so a file written by the same build
+	// for the same STACK and RAM runs straight from its mapped pages. anything else has its instructions decoded again
+	struct bytecode_header
+	{
+		enum section_index
+		{
+			// the instructions, as args
+			CODE,
+			// each label as its instruction index (8 bytes), name length (8 bytes), then name
+			LABELS,
+			// the string literals, copied to the vm's RAM at data_address when the script is loaded
+			DATA,
+			// each relocation as its instruction index and target (8 bytes each)
+			RELOCATIONS,
+			// each import and export, laid out like labels
+			IMPORTS,
+			EXPORTS,
+			SECTION_COUNT
+		};
+		struct section
+		{
+			uint64_t offset, size;
+		};
+		constexpr static char s_magic[4] = { 'S', 'A', 'S', 'M' };
+		constexpr static uint16_t s_version = 3;
+		// version 2 files end their header after the DATA section, and are read as having no symbols
+		constexpr static uint16_t s_oldest_version = 2;
+		// written in the byte order of the machine that wrote the file, so it reads as 0x0201 on one with the other order
+		constexpr static uint16_t s_endian = 0x0102;
+
+		char magic[4];
+		uint16_t version, endian;
+		// of the header, so a later version can tell one it has grown from
+		uint64_t size;
+		// vm::handler_fingerprint of the build that wrote it, and the STACK and RAM its handlers were verified for
+		uint64_t fingerprint, stack, ram;
+		uint64_t entry_point, stack_need, instruction_count, data_address;
+		section sections[SECTION_COUNT];
+
+		// size of the header in files of the given version
+		constexpr static size_t size_of(uint16_t version)
+		{
+			return version == 2 ? offsetof(bytecode_header, sections) + sizeof(section) * (DATA + 1) : sizeof(bytecode_header);
+		}
+		// reverses the byte order of every field (for a file from a machine with the other order)
+		void swap()
+		{
+			version = std::byteswap(version);
+			endian = std::byteswap(endian);
+			for (uint64_t* const field : { &size, &fingerprint, &stack, &ram, &entry_point, &stack_need, &instruction_count, &data_address })
+				*field = std::byteswap(*field);
+			for (section& s : sections)
+			{
+				s.offset = std::byteswap(s.offset);
+				s.size = std::byteswap(s.size);
+			}
+		}
+	};
+	// so the instructions that follow it are aligned
+	static_assert(sizeof(bytecode_header) % alignof(args) == 0);
+
+
+
+	// a file mapped into memory copy-on-write: it can be written to, but nothing written reaches the file, and only pages that are written
+	// get copied
+	class mapped_file
+	{
+	public:
+		mapped_file(const char* const fp) :
+			m_data(nullptr),
+			m_size(0)
+		{
+#ifdef _WIN32
+			const HANDLE file = CreateFileA(fp, GENERIC_READ, FILE_SHARE_READ, nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+			if (file == INVALID_HANDLE_VALUE)
+				return;
+			LARGE_INTEGER size;
+			if (GetFileSizeEx(file, &size) && size.QuadPart > 0)
+			{
+				const HANDLE mapping = CreateFileMappingA(file, nullptr, PAGE_WRITECOPY, 0, 0, nullptr);
+				if (mapping)
+				{
+					m_data = HASL_CAST(uint8_t*, MapViewOfFile(mapping, FILE_MAP_COPY, 0, 0, 0));
+					m_size = m_data ? HASL_CAST(size_t, size.QuadPart) : 0;
+					// the view keeps the mapping open
+					CloseHandle(mapping);
+				}
+			}
+			CloseHandle(file);
+#else
+			const int file = open(fp, O_RDONLY);
+			if (file < 0)
+				return;
+			struct stat info;
+			if (fstat(file, &info) == 0 && info.st_size > 0)
+			{
+				void* const data = mmap(nullptr, HASL_CAST(size_t, info.st_size), PROT_READ | PROT_WRITE, MAP_PRIVATE, file, 0);
+				if (data != MAP_FAILED)
+				{
+					m_data = HASL_CAST(uint8_t*, data);
+					m_size = HASL_CAST(size_t, info.st_size);
+				}
+			}
+			close(file);
+#endif
+		}
+		HASL_DCM(mapped_file);
+		~mapped_file()
+		{
+			if (!m_data)
+				return;
+#ifdef _WIN32
+			UnmapViewOfFile(m_data);
+#else
+			munmap(m_data, m_size);
+#endif
+		}
+	public:
+		// nullptr if the file couldn't be opened or is empty
+		uint8_t* data() const
+		{
+			return m_data;
+		}
+		size_t size() const
+		{
+			return m_size;
+		}
+	private:
+		uint8_t* m_data;
+		size_t m_size;
+	};
+}
@@ -56,16 +56,64 @@ namespace hasl::sasm
 
 
 
+	// type of the register (if any) in one of an instruction's slots
+	enum class reg_type : uint8_t
+	{
+		NONE = 0, I = 1, F = 2, V = 3
+	};
+
+
+
+	// a decoded instruction (16 bytes, so four fit in a cache line)
 	struct args
 	{
-		// register pointers
-		i_t* i[c::command_reg_count] = { nullptr };
-		f_t* f[c::command_reg_count] = { nullptr };
-		v_t* v[c::command_reg_count] = { nullptr };
+		// handler that executes this instruction (the opcode, or a form of it specialized for these operands)
+		uint16_t handler = 0;
+		uint8_t opcode = 0;
+		// reg_type of each slot, 2 bits per slot
+		uint8_t types = 0;
+		// index of each slot's register within its register file (registers::i, f, or v)
+		uint8_t r[c::command_reg_count] = { 0 };
+		uint8_t unused = 0;
+		// immediate value: an int (or label), a float, or two 16-bit ints (for two I_MIS slots)
+		union
+		{
+			i_t ii = 0;
+			f_t fi;
+			int16_t si[4];
+		};
 
-		uint8_t opcode;
-		// immediate values
-		i_t ii[2] = { 0 };
-		f_t fi = 0.f;
+
+		reg_type type(size_t slot) const
+		{
+			return HASL_CAST(reg_type, (types >> (2 * slot)) & 3);
+		}
+		void set_reg(size_t slot, reg_type type, size_t index)
+		{
+			types = HASL_CAST(uint8_t, (types & ~(3 << (2 * slot))) | (HASL_CAST(uint8_t, type) << (2 * slot)));
+			r[slot] = HASL_CAST(uint8_t, index);
+		}
+		// 63-56: opcode, 55-48: types, 47-24: register indices
+		uint64_t encode() const
+		{
+			return
+				(HASL_CAST(uint64_t, opcode) << 56) |
+				(HASL_CAST(uint64_t, types) << 48) |
+				(HASL_CAST(uint64_t, r[0]) << 40) |
+				(HASL_CAST(uint64_t, r[1]) << 32) |
+				(HASL_CAST(uint64_t, r[2]) << 24);
+		}
+		static args decode(uint64_t word, uint64_t immediate)
+		{
+			args a;
+			a.opcode = HASL_CAST(uint8_t, word >> 56);
+			a.types = HASL_CAST(uint8_t, word >> 48);
+			a.r[0] = HASL_CAST(uint8_t, word >> 40);
+			a.r[1] = HASL_CAST(uint8_t, word >> 32);
+			a.r[2] = HASL_CAST(uint8_t, word >> 24);
+			a.ii = HASL_PUN(i_t, immediate);
+			return a;
+		}
 	};
+	static_assert(sizeof(args) == 16);
 }
@@ -29,7 +29,7 @@ namespace hasl::sasm
 
 		// special register indices
 		constexpr static int64_t reg_obj = 16, reg_hst = 17, reg_oc = 18, reg_flag = 19;
-		const static inline std::unordered_map<std::string, size_t> special_regs =
+		const static inline std::unordered_map<std::string_view, size_t> special_regs =
 		{
 			{ "$obj", reg_obj },
 			{ "$hst", reg_hst },
@@ -59,5 +59,7 @@ namespace hasl::sasm
 
 		// language constants
 		constexpr static char label_token = ':', comment_token = ';', reg_token = '$', entry_point_token[] = "main", float_token = '.';
+		// "import <label>" lets a script use a label another script exports with "export <label>" (see linker)
+		constexpr static char import_token[] = "import", export_token[] = "export";
 	}
 }
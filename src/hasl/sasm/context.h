@@ -0,0 +1,28 @@
+#pragma once
+#include "pch.h"
+#include "registers.h"
+#include "scriptable.h"
+
+namespace hasl::sasm
+{
+	// everything a script needs to be suspended and resumed later. each script has its own, so any number of them can be asleep on one vm
+	template<size_t STACK>
+	struct context
+	{
+		registers regs;
+		i_t stack[STACK] = { 0 };
+		// program counter, stack pointer
+		size_t pc = 0, sp = 0;
+		// set by an instruction that stops the script (end, slp, or an error)
+		bool abort = false;
+		// the script executed slp, and resumes after it once current_time reaches sleep_end
+		bool sleeping = false;
+		float sleep_end = 0;
+		// ran out of instruction budget, and resumes where it stopped on the next run
+		bool preempted = false;
+		// instructions the last run was charged for, if it had a budget (see vm::set_instruction_budget)
+		size_t executed = 0;
+		// objects spawned during the current run, handed to vm::process_spawn_queue once it's over
+		std::vector<scriptable*> spawned;
+	};
+}
@@ -1,32 +1,170 @@
 #pragma once
 #include "vm.h"
+#include "verifier.h"
+#include "bytecode.h"
 
 namespace hasl::sasm
 {
-	template<typename T, size_t STACK, size_t RAM>
-	T* deserialize(const char* fp, vm<STACK, RAM>* const vm)
+	// loads a script written by script::serialize from the `size` bytes at `offset` in file, which scripts that run their instructions from
+	// it keep mapped. if it was written by this build for the same STACK and RAM, the script runs its instructions where they are in the
+	// mapped pages, once their handlers are picked and verified again. otherwise (or if it's in the older format without a header, which is
+	// read as big-endian words) they're decoded and verified again. its string literals are written to vm's RAM, unless vm is nullptr (see
+	// vm::load_data). fp is the file's name, for errors, and name the program's (see program::get_filepath)
+	template<typename T, size_t STACK = T::s_stack, size_t RAM = T::s_ram>
+	T* deserialize(const std::shared_ptr<mapped_file>& file, size_t offset, size_t size, std::type_identity_t<vm<STACK, RAM>>* const vm, const char* fp,
+		const char* name)
 	{
-		std::ifstream in(fp);
-		if (!in.is_open())
+		typedef sasm::vm<STACK, RAM> machine;
+		uint8_t* const data = file->data() + offset;
+
+		bytecode_header h = {};
+		if (size < bytecode_header::size_of(bytecode_header::s_oldest_version) || memcmp(data, bytecode_header::s_magic, sizeof(h.magic)) != 0)
 		{
-			printf("Error opening sasm file '%s'\n", fp);
+			auto word = [&](size_t i)
+			{
+				uint64_t w = 0;
+				for (size_t b = 0; b < sizeof(w); b++)
+					w = (w << 8) | data[i * sizeof(w) + b];
+				return w;
+			};
+			const size_t words = size / sizeof(uint64_t);
+			if (words == 0)
+			{
+				printf("Error reading sasm file '%s'\n", fp);
+				return nullptr;
+			}
+			// each instruction is two words: opcode and registers, then the immediate
+			std::vector<args> instructions((words - 1) / 2);
+			for (size_t i = 0; i < instructions.size(); i++)
+			{
+				if (!machine::deserialize(word(2 * i + 1), word(2 * i + 2), &instructions[i]))
+				{
+					printf("Error reading sasm file '%s'\n", fp);
+					return nullptr;
+				}
+			}
+			return new T(word(0), instructions, {}, data_segment(), symbol_table(), name);
+		}
+
+		memcpy(&h, data, std::min(size, sizeof(h)));
+		const bool swapped = h.endian != bytecode_header::s_endian;
+		if (swapped)
+			h.swap();
+		if (h.endian != bytecode_header::s_endian || h.version < bytecode_header::s_oldest_version || h.version > bytecode_header::s_version ||
+			h.size != bytecode_header::size_of(h.version) || h.size > size)
+		{
+			printf("Unsupported sasm bytecode version %u in '%s'\n", HASL_CAST(unsigned, h.version), fp);
+			return nullptr;
+		}
+		// sections an older version doesn't have are empty
+		const size_t section_count = (h.size - offsetof(bytecode_header, sections)) / sizeof(bytecode_header::section);
+		std::fill(std::begin(h.sections) + section_count, std::end(h.sections), bytecode_header::section{});
+
+		auto fits = [&](const bytecode_header::section& s)
+		{
+			return s.offset <= size && s.size <= size - s.offset;
+		};
+		const bytecode_header::section& code = h.sections[bytecode_header::CODE];
+		const bytecode_header::section& names = h.sections[bytecode_header::LABELS];
+		const bytecode_header::section& strings = h.sections[bytecode_header::DATA];
+		const bytecode_header::section& relocations = h.sections[bytecode_header::RELOCATIONS];
+		if (!std::all_of(std::begin(h.sections), std::end(h.sections), fits) || reinterpret_cast<uintptr_t>(data + code.offset) % alignof(args) != 0 ||
+			code.size / sizeof(args) != h.instruction_count || code.size % sizeof(args) != 0)
+		{
+			printf("Error reading sasm file '%s'\n", fp);
 			return nullptr;
 		}
 
-		const size_t entry_point = read_ulong(in);
+		// the fields of each entry in a section are 8 bytes, in the file's byte order
+		auto field = [&](size_t at)
+		{
+			uint64_t f;
+			memcpy(&f, data + at, sizeof(f));
+			return swapped ? std::byteswap(f) : f;
+		};
+		// labels, imports, and exports
+		auto read_names = [&](const bytecode_header::section& section)
+		{
+			std::vector<std::pair<size_t, std::string>> list;
+			for (size_t at = section.offset, end = section.offset + section.size; end - at >= 2 * sizeof(uint64_t);)
+			{
+				const uint64_t pc = field(at), length = field(at + sizeof(uint64_t));
+				at += 2 * sizeof(uint64_t);
+				if (length > end - at)
+					break;
+				list.emplace_back(pc, std::string(reinterpret_cast<const char*>(data + at), length));
+				at += length;
+			}
+			return list;
+		};
+		const std::vector<std::pair<size_t, std::string>> labels = read_names(names);
+		symbol_table symbols = { {}, read_names(h.sections[bytecode_header::IMPORTS]), read_names(h.sections[bytecode_header::EXPORTS]) };
+		for (size_t at = relocations.offset; relocations.offset + relocations.size - at >= 2 * sizeof(uint64_t); at += 2 * sizeof(uint64_t))
+		{
+			const relocation r = { field(at), HASL_CAST(relocation::target_t, field(at + sizeof(uint64_t))) };
+			if (r.index >= h.instruction_count || r.target > relocation::DATA)
+			{
+				printf("Error reading sasm file '%s'\n", fp);
+				return nullptr;
+			}
+			symbols.relocations.push_back(r);
+		}
+		// linker writes to the instruction that uses each import
+		if (std::any_of(symbols.imports.begin(), symbols.imports.end(), [&](const auto& i) { return i.first >= h.instruction_count; }))
+		{
+			printf("Error reading sasm file '%s'\n", fp);
+			return nullptr;
+		}
 
-		std::vector<uint64_t> byte_code;
-		std::vector<args> instructions;
+		data_segment segment = { h.data_address, std::vector<uint8_t>(data + strings.offset, data + strings.offset + strings.size) };
+		if (vm ? !vm->load_data(segment) : segment.address > RAM || segment.bytes.size() > RAM - segment.address)
+		{
+			printf("String literals in '%s' don't fit in RAM\n", fp);
+			return nullptr;
+		}
 
-		while (true)
+		const std::span<args> instructions(reinterpret_cast<args*>(data + code.offset), h.instruction_count);
+		bool runnable = !swapped && h.fingerprint == machine::handler_fingerprint() && h.stack == STACK && h.ram == RAM;
+		for (size_t i = 0; i < instructions.size() && runnable; i++)
+			runnable = machine::is_valid(instructions[i]);
+		if (runnable)
 		{
-			uint64_t instruction = read_ulong(in);
-			if (in.eof())
-				break;
-			byte_code.push_back(instruction);
-			instructions.push_back(vm->deserialize(instruction));
+			// a matching fingerprint only says which build wrote the handlers, not that a damaged or crafted file doesn't name unchecked ones
+			// that don't hold, so they're picked and verified again. that's done in a copy, and only handlers that come out different are
+			// written to the mapping: a file this build wrote leaves its pages clean (written ones stop being shared with the file), and a
+			// script already running from it (another load of the same archive entry) isn't written under. so each load still costs a copy
+			// of the code and a verifier pass
+			std::vector<args> picked(instructions.begin(), instructions.end());
+			machine::reselect(picked);
+			const size_t stack_need = verifier<STACK, RAM>::verify(picked, { h.entry_point }).front();
+			for (size_t i = 0; i < instructions.size(); i++)
+				if (instructions[i].handler != picked[i].handler)
+					instructions[i].handler = picked[i].handler;
+			return new T(h.entry_point, instructions, stack_need, labels, segment, symbols, file, name);
 		}
 
-		return new T(entry_point, byte_code, instructions);
+		// the handlers were picked by another build (or for another STACK and RAM), so they're picked again
+		std::vector<args> decoded(instructions.size());
+		for (size_t i = 0; i < instructions.size(); i++)
+		{
+			const uint64_t immediate = HASL_CAST(uint64_t, instructions[i].ii);
+			if (!machine::deserialize(instructions[i].encode(), swapped ? std::byteswap(immediate) : immediate, &decoded[i]))
+			{
+				printf("Error reading sasm file '%s'\n", fp);
+				return nullptr;
+			}
+		}
+		return new T(h.entry_point, decoded, labels, segment, symbols, name);
+	}
+	template<typename T, size_t STACK = T::s_stack, size_t RAM = T::s_ram>
+	T* deserialize(const char* fp, std::type_identity_t<vm<STACK, RAM>>* const vm)
+	{
+		const auto file = std::make_shared<mapped_file>(fp);
+		if (!file->data())
+		{
+			printf("Error opening sasm file '%s'\n", fp);
+			return nullptr;
+		}
+		return deserialize<T>(file, 0, file->size(), vm, fp, fp);
 	}
 }
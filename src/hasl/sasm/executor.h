@@ -0,0 +1,178 @@
+#pragma once
+#include "pch.h"
+
+namespace hasl::sasm
+{
+	// fixed pool of threads that runs batches of independent jobs. each thread is given a contiguous share of a batch's job indices, which
+	// it claims a chunk at a time, then claims chunks from the others' shares once it runs out, so a batch of uneven jobs still finishes at
+	// about the same time on every thread. claiming a chunk is one atomic add, and the job is called through one indirect call per chunk
+	class executor
+	{
+	public:
+		// thread_count includes the thread that calls run (0 uses one per hardware thread)
+		executor(size_t thread_count = 0) :
+			m_generation(0),
+			m_busy(0),
+			m_stop(false),
+			m_call(nullptr),
+			m_job(nullptr),
+			m_chunk(1),
+			m_remaining(0)
+		{
+			if (thread_count == 0)
+				thread_count = std::max(HASL_CAST(size_t, std::thread::hardware_concurrency()), HASL_CAST(size_t, 1));
+
+			for (size_t i = 0; i < thread_count; i++)
+				m_shares.push_back(std::make_unique<share>());
+			// the caller is thread 0
+			for (size_t i = 1; i < thread_count; i++)
+				m_threads.emplace_back(&executor::worker, this, i);
+		}
+		HASL_DCM(executor);
+		~executor()
+		{
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_stop = true;
+			}
+			m_wake.notify_all();
+			for (auto& t : m_threads)
+				t.join();
+		}
+	public:
+		size_t get_thread_count() const
+		{
+			return m_shares.size();
+		}
+		// calls job(i) for every i in [0, count) on the pool's threads (including this one), and returns once they've all finished
+		template<typename F>
+		void run(size_t count, const F& job)
+		{
+			if (count == 0)
+				return;
+
+			// contiguous shares, so neighboring jobs (and their scripts) tend to stay on one thread
+			const size_t threads = m_shares.size();
+			for (size_t i = 0; i < threads; i++)
+			{
+				m_shares[i]->next.store(count * i / threads, std::memory_order_relaxed);
+				m_shares[i]->end = count * (i + 1) / threads;
+			}
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_call = [](const void* const f, size_t begin, size_t end)
+				{
+					for (size_t i = begin; i < end; i++)
+						(*HASL_CAST(const F*, f))(i);
+				};
+				m_job = &job;
+				m_chunk = std::max(count / (threads * s_chunks), HASL_CAST(size_t, 1));
+				m_remaining = count;
+				m_generation++;
+			}
+			m_wake.notify_all();
+
+			work(0, m_call, m_job);
+
+			// wait for the last jobs, and for every worker to let go of this batch before the next one can start
+			std::unique_lock<std::mutex> lock(m_lock);
+			m_done.wait(lock, [&]() { return m_remaining == 0 && m_busy == 0; });
+			m_call = nullptr;
+			m_job = nullptr;
+		}
+	private:
+		// chunks in a thread's share, when the jobs are split evenly (fewer is less claiming, more evens out uneven jobs better)
+		constexpr static size_t s_chunks = 8;
+	private:
+		typedef void (*call)(const void* job, size_t begin, size_t end);
+		// the job indices a thread starts on, [next, end), on a cache line of their own since every thread claims from them
+		struct alignas(64) share
+		{
+			std::atomic<size_t> next = 0;
+			size_t end = 0;
+		};
+	private:
+		std::vector<std::unique_ptr<share>> m_shares;
+		std::vector<std::thread> m_threads;
+		std::mutex m_lock;
+		std::condition_variable m_wake, m_done;
+		// batches started, and workers currently running one
+		size_t m_generation, m_busy;
+		bool m_stop;
+		// the current batch's job, called by m_call for each chunk, and how many jobs a chunk is
+		call m_call;
+		const void* m_job;
+		size_t m_chunk;
+		// jobs in the current batch that haven't finished
+		size_t m_remaining;
+	private:
+		void worker(size_t self)
+		{
+			size_t seen = 0;
+			while (true)
+			{
+				call c = nullptr;
+				const void* job = nullptr;
+				{
+					std::unique_lock<std::mutex> lock(m_lock);
+					m_wake.wait(lock, [&]() { return m_stop || (m_generation != seen && m_job); });
+					if (m_stop)
+						return;
+					seen = m_generation;
+					c = m_call;
+					job = m_job;
+					m_busy++;
+				}
+
+				work(self, c, job);
+
+				{
+					std::lock_guard<std::mutex> lock(m_lock);
+					m_busy--;
+				}
+				m_done.notify_all();
+			}
+		}
+		// runs chunks from this thread's share, then from the others' until there are none left
+		void work(size_t self, call c, const void* const job)
+		{
+			size_t done = 0, begin = 0, end = 0;
+			while (claim(self, &begin, &end))
+			{
+				c(job, begin, end);
+				done += end - begin;
+			}
+			if (done == 0)
+				return;
+
+			bool last = false;
+			{
+				std::lock_guard<std::mutex> lock(m_lock);
+				m_remaining -= done;
+				last = (m_remaining == 0);
+			}
+			if (last)
+				m_done.notify_all();
+		}
+		bool claim(size_t self, size_t* const begin, size_t* const end)
+		{
+			// the batch's shares and chunk were set before it was started under m_lock, which this thread has taken since
+			const size_t threads = m_shares.size();
+			for (size_t k = 0; k < threads; k++)
+			{
+				share& s = *m_shares[(self + k) % threads];
+				if (s.next.load(std::memory_order_relaxed) >= s.end)
+					continue;
+				// claims that land past the end (when threads race for the last chunk) just find nothing
+				const size_t first = s.next.fetch_add(m_chunk, std::memory_order_relaxed);
+				if (first < s.end)
+				{
+					*begin = first;
+					*end = std::min(first + m_chunk, s.end);
+					return true;
+				}
+			}
+			return false;
+		}
+	};
+}
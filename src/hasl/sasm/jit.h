@@ -0,0 +1,505 @@
+#pragma once
+#include "pch.h"
+#include "registers.h"
+#include "command.h"
+
+#if HASL_JIT
+#ifdef _WIN32
+#ifndef NOMINMAX
+#define NOMINMAX
+#endif
+#include <windows.h>
+#else
+#include <sys/mman.h>
+#endif
+#endif
+
+namespace hasl::sasm
+{
+	template<size_t, size_t>
+	class script;
+	template<size_t, size_t>
+	class program;
+	template<size_t, size_t>
+	class vm;
+	struct script_runtime;
+
+
+
+	// executable memory holding one compiled script
+	class jit_code
+	{
+	public:
+		// entry(frame, pc) runs the script starting at pc
+		typedef void(*entry)(void*, size_t);
+	public:
+		// a script that couldn't be compiled (it keeps running in the interpreter)
+		jit_code() :
+			m_memory(nullptr),
+			m_size(0),
+			m_entry(nullptr)
+		{}
+		// `table_offset` is where the native address of each instruction goes (filled in here, once the code has an address)
+		jit_code(const std::vector<uint8_t>& code, const std::vector<size_t>& offsets, size_t table_offset) :
+			m_memory(nullptr),
+			m_size(code.size()),
+			m_entry(nullptr)
+		{
+#if HASL_JIT
+#ifdef _WIN32
+			m_memory = HASL_CAST(uint8_t*, VirtualAlloc(nullptr, m_size, MEM_COMMIT | MEM_RESERVE, PAGE_READWRITE));
+#else
+			void* memory = mmap(nullptr, m_size, PROT_READ | PROT_WRITE, MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+			m_memory = HASL_CAST(uint8_t*, memory == MAP_FAILED ? nullptr : memory);
+#endif
+			if (!m_memory)
+				return;
+
+			memcpy(m_memory, code.data(), m_size);
+			uint64_t* const table = HASL_CAST(uint64_t*, HASL_CAST(void*, m_memory + table_offset));
+			for (size_t i = 0; i < offsets.size(); i++)
+				table[i] = HASL_CAST(uint64_t, reinterpret_cast<uintptr_t>(m_memory + offsets[i]));
+
+			// never writable and executable at the same time
+#ifdef _WIN32
+			DWORD old;
+			if (!VirtualProtect(m_memory, m_size, PAGE_EXECUTE_READ, &old))
+				return;
+#else
+			if (mprotect(m_memory, m_size, PROT_READ | PROT_EXEC) != 0)
+				return;
+#endif
+			m_entry = reinterpret_cast<entry>(m_memory);
+#endif
+		}
+		HASL_DCM(jit_code);
+		~jit_code()
+		{
+#if HASL_JIT
+			if (!m_memory)
+				return;
+#ifdef _WIN32
+			VirtualFree(m_memory, 0, MEM_RELEASE);
+#else
+			munmap(m_memory, m_size);
+#endif
+#endif
+		}
+	public:
+		bool valid() const
+		{
+			return m_entry != nullptr;
+		}
+		void operator()(void* frame, size_t pc) const
+		{
+			m_entry(frame, pc);
+		}
+	private:
+		uint8_t* m_memory;
+		size_t m_size;
+		entry m_entry;
+	};
+
+
+
+	// just enough of an x86-64 assembler for the jit. memory operands are always [rbx + disp32], and rbx holds the register file
+	class x64_emitter
+	{
+	public:
+		// general purpose and xmm register numbers
+		constexpr static uint8_t rax = 0, rcx = 1;
+		constexpr static uint8_t xmm0 = 0, xmm1 = 1;
+		// condition codes for jcc
+		constexpr static uint8_t jb = 0x82, jae = 0x83, je = 0x84, jne = 0x85, ja = 0x87, jp = 0x8a, jl = 0x8c, jge = 0x8d, jle = 0x8e, jg = 0x8f;
+	public:
+		std::vector<uint8_t> bytes;
+	public:
+		size_t size() const
+		{
+			return bytes.size();
+		}
+		void emit(std::initializer_list<uint8_t> b)
+		{
+			bytes.insert(bytes.end(), b);
+		}
+		void emit32(uint32_t i)
+		{
+			for (size_t b = 0; b < 4; b++)
+				bytes.push_back(HASL_CAST(uint8_t, i >> (8 * b)));
+		}
+		void emit64(uint64_t i)
+		{
+			for (size_t b = 0; b < 8; b++)
+				bytes.push_back(HASL_CAST(uint8_t, i >> (8 * b)));
+		}
+		// <op> reg, [rbx + disp] (or the reverse, depending on the opcode)
+		void mem(std::initializer_list<uint8_t> op, uint8_t reg, size_t disp)
+		{
+			emit(op);
+			bytes.push_back(HASL_CAST(uint8_t, 0x80 | ((reg & 7) << 3) | 3));
+			emit32(HASL_CAST(uint32_t, disp));
+		}
+		// mov rax, imm64
+		void mov_rax(uint64_t imm)
+		{
+			emit({ 0x48, 0xb8 });
+			emit64(imm);
+		}
+		// jcc/jmp rel32 with the offset left blank, returns where the offset goes
+		size_t jcc(uint8_t cc)
+		{
+			emit({ 0x0f, cc });
+			emit32(0);
+			return size() - 4;
+		}
+		size_t jmp()
+		{
+			emit({ 0xe9 });
+			emit32(0);
+			return size() - 4;
+		}
+		// point the rel32 at `at` to `target`
+		void patch(size_t at, size_t target)
+		{
+			const uint32_t rel = HASL_CAST(uint32_t, HASL_CAST(int64_t, target) - HASL_CAST(int64_t, at + 4));
+			for (size_t b = 0; b < 4; b++)
+				bytes[at + b] = HASL_CAST(uint8_t, rel >> (8 * b));
+		}
+	};
+
+
+
+	// baseline compiler from a script's decoded instructions to x86-64. common integer, float, and vec arithmetic, moves, and branches
+	// become native code that works directly on the register file; everything else (engine callbacks, the stack, memory, ...) calls
+	// back into the interpreter's handler for that one instruction.
+	template<size_t STACK, size_t RAM>
+	class jit
+	{
+	public:
+		// passed to the compiled code
+		struct frame
+		{
+			vm<STACK, RAM>* machine;
+			script<STACK, RAM>* s;
+			script_runtime* rt;
+			registers* regs;
+			// instructions left before the script is preempted
+			int64_t budget;
+		};
+	public:
+		static std::unique_ptr<jit_code> compile(const program<STACK, RAM>& p)
+		{
+#if HASL_JIT
+			typedef vm<STACK, RAM> machine;
+			typedef typename machine::op op;
+			const std::span<const args> code = p.get_instructions();
+			const size_t count = code.size();
+
+			x64_emitter e;
+			std::vector<size_t> offsets(count);
+			// rel32 offsets that jump to an instruction, to the exit, and to the dispatcher
+			std::vector<branch> branches;
+			std::vector<size_t> exits, dispatches;
+
+			// prologue: save rbx/r12 and keep 16 byte alignment plus shadow space for calls
+			e.emit({ 0x53, 0x41, 0x54, 0x48, 0x83, 0xec, 0x28 });
+#ifdef _WIN32
+			// mov r12, rcx; mov rax, rdx
+			e.emit({ 0x49, 0x89, 0xcc, 0x48, 0x89, 0xd0 });
+#else
+			// mov r12, rdi; mov rax, rsi
+			e.emit({ 0x49, 0x89, 0xfc, 0x48, 0x89, 0xf0 });
+#endif
+			// mov rbx, [r12 + regs]
+			e.emit({ 0x49, 0x8b, 0x5c, 0x24, HASL_CAST(uint8_t, offsetof(frame, regs)) });
+			dispatches.push_back(e.jmp());
+
+			for (size_t pc = 0; pc < count; pc++)
+			{
+				offsets[pc] = e.size();
+				const args& a = code[pc];
+				// compile the parts of a superinstruction separately
+				const op form = HASL_CAST(op, machine::quicken(a));
+				if (!emit_native(e, a, form, pc, count, &branches))
+					emit_fallback(e, pc, &dispatches);
+			}
+
+			// falling off the end, or the interpreter said to stop
+			const size_t exit = e.size();
+			e.emit({ 0x48, 0x83, 0xc4, 0x28, 0x41, 0x5c, 0x5b, 0xc3 });
+
+			// jump to the instruction in rax, or exit if it's out of range
+			const size_t dispatch = e.size();
+			// cmp rax, count; jae exit
+			e.emit({ 0x48, 0x3d });
+			e.emit32(HASL_CAST(uint32_t, count));
+			exits.push_back(e.jcc(x64_emitter::jae));
+			// lea rcx, [rip + table]; jmp [rcx + rax * 8]
+			e.emit({ 0x48, 0x8d, 0x0d });
+			const size_t table_rel = e.size();
+			e.emit32(0);
+			e.emit({ 0xff, 0x24, 0xc1 });
+
+			while (e.size() % 8)
+				e.emit({ 0xcc });
+			const size_t table = e.size();
+			e.bytes.resize(table + count * sizeof(uint64_t));
+			e.patch(table_rel, table);
+
+			// branches back charge the budget for the length of the loop, and stop at the target once it runs out
+			for (const branch& b : branches)
+			{
+				if (b.target > b.pc)
+				{
+					e.patch(b.at, offsets[b.target]);
+					continue;
+				}
+				e.patch(b.at, e.size());
+				// sub qword [r12 + budget], length; jg target
+				e.emit({ 0x49, 0x81, 0x6c, 0x24, HASL_CAST(uint8_t, offsetof(frame, budget)) });
+				e.emit32(HASL_CAST(uint32_t, b.pc - b.target + 1));
+				e.patch(e.jcc(x64_emitter::jg), offsets[b.target]);
+				emit_call(e, &jit::preempt, b.target);
+				exits.push_back(e.jmp());
+			}
+			for (const size_t at : exits)
+				e.patch(at, exit);
+			for (const size_t at : dispatches)
+				e.patch(at, dispatch);
+
+			return std::make_unique<jit_code>(e.bytes, offsets, table);
+#else
+			return std::make_unique<jit_code>();
+#endif
+		}
+	private:
+		// returned by step when the script stopped
+		constexpr static size_t s_stop = ~HASL_CAST(size_t, 0);
+	private:
+		// a rel32 at `at`, in the code for instruction pc, that jumps to instruction target
+		struct branch
+		{
+			size_t at, target, pc;
+		};
+	private:
+		// runs the instruction at pc in the interpreter, returns the next pc
+		static size_t step(frame* const f, size_t pc)
+		{
+			f->s->m_context.pc = pc;
+			if (!f->machine->step(*f->s, *f->rt))
+				return s_stop;
+			// out of budget, so the vm resumes at the next instruction
+			return --f->budget > 0 ? f->s->m_context.pc : s_stop;
+		}
+		// stops the script so that it resumes at pc
+		static size_t preempt(frame* const f, size_t pc)
+		{
+			f->s->m_context.pc = pc;
+			return s_stop;
+		}
+		static size_t off_i(const args& a, size_t n)
+		{
+			return offsetof(registers, i) + sizeof(i_t) * a.r[n];
+		}
+		static size_t off_f(const args& a, size_t n)
+		{
+			return offsetof(registers, f) + sizeof(f_t) * a.r[n];
+		}
+		static size_t off_v(const args& a, size_t n)
+		{
+			return offsetof(registers, v) + sizeof(v_t) * a.r[n];
+		}
+		static bool fits32(i_t i)
+		{
+			return i >= std::numeric_limits<int32_t>::min() && i <= std::numeric_limits<int32_t>::max();
+		}
+		// call fn(frame, pc)
+		static void emit_call(x64_emitter& e, size_t(*fn)(frame*, size_t), size_t pc)
+		{
+#ifdef _WIN32
+			// mov rcx, r12; mov rdx, pc
+			e.emit({ 0x4c, 0x89, 0xe1, 0x48, 0xba });
+#else
+			// mov rdi, r12; mov rsi, pc
+			e.emit({ 0x4c, 0x89, 0xe7, 0x48, 0xbe });
+#endif
+			e.emit64(pc);
+			// mov rax, fn; call rax
+			e.mov_rax(HASL_CAST(uint64_t, reinterpret_cast<uintptr_t>(fn)));
+			e.emit({ 0xff, 0xd0 });
+		}
+		// call step(frame, pc), and go through the dispatcher unless it returned pc + 1
+		static void emit_fallback(x64_emitter& e, size_t pc, std::vector<size_t>* const dispatches)
+		{
+			emit_call(e, &jit::step, pc);
+			// cmp rax, pc + 1; jne dispatch
+			e.emit({ 0x48, 0x3d });
+			e.emit32(HASL_CAST(uint32_t, pc + 1));
+			dispatches->push_back(e.jcc(x64_emitter::jne));
+		}
+		template<typename OP>
+		static bool emit_native(x64_emitter& e, const args& a, OP form, size_t pc, size_t count, std::vector<branch>* const branches)
+		{
+			typedef x64_emitter x;
+			// rax = int slot n / store rax in int slot n
+			auto load = [&](size_t n) { e.mem({ 0x48, 0x8b }, x::rax, off_i(a, n)); };
+			auto store = [&](size_t n) { e.mem({ 0x48, 0x89 }, x::rax, off_i(a, n)); };
+			// op rax, [int slot 1] and op rax, imm32 (as reg /ext)
+			auto int_r = [&](std::initializer_list<uint8_t> op) { load(0); e.mem(op, x::rax, off_i(a, 1)); store(2); return true; };
+			auto int_i = [&](uint8_t ext)
+			{
+				if (!fits32(a.ii))
+					return false;
+				load(0);
+				e.emit({ 0x48, 0x81, HASL_CAST(uint8_t, 0xc0 | (ext << 3)) });
+				e.emit32(HASL_CAST(uint32_t, a.ii));
+				store(2);
+				return true;
+			};
+			// xmm0 = float slot 0, <op>sd xmm0, (float slot 1 | immediate), float slot 2 = xmm0
+			auto float_r = [&](uint8_t op)
+			{
+				e.mem({ 0xf2, 0x0f, 0x10 }, x::xmm0, off_f(a, 0));
+				e.mem({ 0xf2, 0x0f, op }, x::xmm0, off_f(a, 1));
+				e.mem({ 0xf2, 0x0f, 0x11 }, x::xmm0, off_f(a, 2));
+				return true;
+			};
+			auto float_i = [&](uint8_t op)
+			{
+				e.mem({ 0xf2, 0x0f, 0x10 }, x::xmm0, off_f(a, 0));
+				// movq xmm1, rax
+				e.mov_rax(HASL_PUN(uint64_t, a.fi));
+				e.emit({ 0x66, 0x48, 0x0f, 0x6e, 0xc8 });
+				e.emit({ 0xf2, 0x0f, op, 0xc1 });
+				e.mem({ 0xf2, 0x0f, 0x11 }, x::xmm0, off_f(a, 2));
+				return true;
+			};
+			// both components of a vec at once: movq xmm0/xmm1, <op>ps xmm0, xmm1, movq back
+			auto vec_v = [&](uint8_t op)
+			{
+				e.mem({ 0xf3, 0x0f, 0x7e }, x::xmm0, off_v(a, 0));
+				e.mem({ 0xf3, 0x0f, 0x7e }, x::xmm1, off_v(a, 1));
+				e.emit({ 0x0f, op, 0xc1 });
+				e.mem({ 0x66, 0x0f, 0xd6 }, x::xmm0, off_v(a, 2));
+				return true;
+			};
+			// copy 8 bytes between slots, or store an 8 byte constant
+			auto copy = [&](size_t from, size_t to)
+			{
+				e.mem({ 0x48, 0x8b }, x::rax, from);
+				e.mem({ 0x48, 0x89 }, x::rax, to);
+				return true;
+			};
+			auto constant = [&](uint64_t bits, size_t to)
+			{
+				e.mov_rax(bits);
+				e.mem({ 0x48, 0x89 }, x::rax, to);
+				return true;
+			};
+			// jcc to the label in the immediate (out of range targets are left to the interpreter's range check)
+			auto jump = [&](uint8_t cc)
+			{
+				branches->push_back({ cc ? e.jcc(cc) : e.jmp(), HASL_CAST(size_t, a.ii), pc });
+				return true;
+			};
+			const bool target_ok = a.ii >= 0 && HASL_CAST(size_t, a.ii) < count;
+			auto int_branch = [&](uint8_t cc)
+			{
+				if (!target_ok)
+					return false;
+				// mov rax, [slot 0]; cmp rax, [slot 1]
+				load(0);
+				e.mem({ 0x48, 0x3b }, x::rax, off_i(a, 1));
+				return jump(cc);
+			};
+			// `swap` compares slot 1 to slot 0, so that unordered (NaN) comparisons fall through like they do in C++
+			auto float_branch = [&](uint8_t cc, bool swap)
+			{
+				if (!target_ok)
+					return false;
+				e.mem({ 0xf2, 0x0f, 0x10 }, x::xmm0, off_f(a, 0));
+				e.mem({ 0xf2, 0x0f, 0x10 }, x::xmm1, off_f(a, 1));
+				// ucomisd xmm1, xmm0 / ucomisd xmm0, xmm1
+				e.emit({ 0x66, 0x0f, 0x2e, HASL_CAST(uint8_t, swap ? 0xc8 : 0xc1) });
+				return jump(cc);
+			};
+
+			switch (form)
+			{
+			case OP::add_r:		return int_r({ 0x48, 0x03 });
+			case OP::sub_r:		return int_r({ 0x48, 0x2b });
+			case OP::band_r:	return int_r({ 0x48, 0x23 });
+			case OP::bor_r:		return int_r({ 0x48, 0x0b });
+			case OP::bxor_r:	return int_r({ 0x48, 0x33 });
+			case OP::mul_r:		return int_r({ 0x48, 0x0f, 0xaf });
+			case OP::add_i:		return int_i(0);
+			case OP::bor_i:		return int_i(1);
+			case OP::band_i:	return int_i(4);
+			case OP::sub_i:		return int_i(5);
+			case OP::bxor_i:	return int_i(6);
+			case OP::mul_i:
+				if (!fits32(a.ii))
+					return false;
+				// imul rax, rax, imm32
+				load(0);
+				e.emit({ 0x48, 0x69, 0xc0 });
+				e.emit32(HASL_CAST(uint32_t, a.ii));
+				store(2);
+				return true;
+			case OP::addf_r:	return float_r(0x58);
+			case OP::subf_r:	return float_r(0x5c);
+			case OP::mulf_r:	return float_r(0x59);
+			case OP::divf_r:	return float_r(0x5e);
+			case OP::addf_i:	return float_i(0x58);
+			case OP::subf_i:	return float_i(0x5c);
+			case OP::mulf_i:	return float_i(0x59);
+			case OP::divf_i:	return float_i(0x5e);
+			case OP::addv_v:	return vec_v(0x58);
+			case OP::subv_v:	return vec_v(0x5c);
+			case OP::mulv_v:	return vec_v(0x59);
+			case OP::divv_v:	return vec_v(0x5e);
+			case OP::mov_i:		return copy(off_i(a, 0), off_i(a, 1));
+			case OP::mov_m:		return constant(HASL_PUN(uint64_t, a.ii), off_i(a, 1));
+			case OP::movf_f:	return copy(off_f(a, 0), off_f(a, 1));
+			case OP::movf_m:	return constant(HASL_PUN(uint64_t, a.fi), off_f(a, 1));
+			case OP::movv_v:	return copy(off_v(a, 0), off_v(a, 1));
+			case OP::movv_m:
+			{
+				const v_t v = a.fi;
+				return constant(HASL_PUN(uint64_t, v), off_v(a, 1));
+			}
+			case OP::mov_f:
+				// cvttsd2si rax, [slot 0]
+				e.mem({ 0xf2, 0x48, 0x0f, 0x2c }, x::rax, off_f(a, 0));
+				e.mem({ 0x48, 0x89 }, x::rax, off_i(a, 1));
+				return true;
+			case OP::movf_i:
+				// cvtsi2sd xmm0, [slot 0]
+				e.mem({ 0xf2, 0x48, 0x0f, 0x2a }, x::xmm0, off_i(a, 0));
+				e.mem({ 0xf2, 0x0f, 0x11 }, x::xmm0, off_f(a, 1));
+				return true;
+			case OP::beq_i:		return int_branch(x::je);
+			case OP::bne_i:		return int_branch(x::jne);
+			case OP::blt_i:		return int_branch(x::jl);
+			case OP::bgt_i:		return int_branch(x::jg);
+			case OP::ble_i:		return int_branch(x::jle);
+			case OP::bge_i:		return int_branch(x::jge);
+			case OP::blt_f:		return float_branch(x::ja, true);
+			case OP::ble_f:		return float_branch(x::jae, true);
+			case OP::bgt_f:		return float_branch(x::ja, false);
+			case OP::bge_f:		return float_branch(x::jae, false);
+			case OP::beqz_i:
+				if (!target_ok)
+					return false;
+				// test rax, rax
+				load(0);
+				e.emit({ 0x48, 0x85, 0xc0 });
+				return jump(x::je);
+			case OP::j:
+				return target_ok && jump(0);
+			default:
+				return false;
+			}
+		}
+	};
+}
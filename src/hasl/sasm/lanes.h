@@ -0,0 +1,482 @@
+#pragma once
+#include "pch.h"
+#include "vm.h"
+
+namespace hasl::sasm
+{
+	// runs many copies of one program (each its own script, with its own host and state) in lockstep groups. a group's lanes share a program
+	// counter and keep their registers side by side, so arithmetic, moves, and branches run across the whole group in one fixed-width loop
+	// that the compiler turns into packed instructions (SSE2 on any x86-64, AVX2 where the build enables it). everything else runs the
+	// instruction's handler on each lane's own script. lanes that branch different ways are masked off: the ones furthest behind go first, so
+	// they meet up again where their paths join, and a group that stays split up finishes in the interpreter instead. instruction budgets
+	// don't apply here.
+	template<size_t STACK, size_t RAM>
+	class lanes
+	{
+	public:
+		// scripts per group
+		constexpr static size_t width = 16;
+	public:
+		static std::vector<i_t> run(vm<STACK, RAM>& machine, const std::vector<typename vm<STACK, RAM>::job>& jobs)
+		{
+			std::vector<i_t> flags(jobs.size(), 0);
+			std::vector<uint8_t> ran(jobs.size(), false);
+			if (jobs.empty())
+				return flags;
+
+			// each instruction's handler, without superinstructions (the group takes them one at a time)
+			const std::span<const args> code = jobs[0].s->m_instructions;
+			std::vector<op> forms(code.size());
+			for (size_t i = 0; i < code.size(); i++)
+				forms[i] = HASL_CAST(op, machine_t::quicken(code[i]));
+
+			const std::unique_ptr<group> g = std::make_unique<group>();
+			for (size_t i = 0; i < jobs.size();)
+			{
+				g->clear();
+				for (; i < jobs.size() && g->count < width; i++)
+				{
+					script<STACK, RAM>& s = *jobs[i].s;
+					// profiled runs are counted one instruction at a time, which lockstep groups don't do
+					if (machine.m_profiler || !same_program(*jobs[0].s, s))
+						ran[i] = machine.invoke(s, *jobs[i].rt, machine.m_instruction_budget);
+					else if ((ran[i] = machine.prepare(s, *jobs[i].rt)))
+						g->add(s, *jobs[i].rt);
+				}
+				if (g->count)
+				{
+					const tracer::span t(machine.m_tracer, "lanes", jobs[0].s->m_program->m_filepath.c_str());
+					g->run(machine, forms);
+				}
+			}
+
+			for (size_t i = 0; i < jobs.size(); i++)
+				if (ran[i])
+				{
+					flags[i] = jobs[i].s->m_context.regs.i[c::reg_flag];
+					machine.hand_over_spawns(*jobs[i].s, *jobs[i].rt);
+				}
+			return flags;
+		}
+	private:
+		typedef vm<STACK, RAM> machine_t;
+		typedef typename machine_t::op op;
+		typedef typename machine_t::operation operation;
+		// instructions a group may spend with half or fewer of its lanes active before the rest of them finish in the interpreter
+		constexpr static size_t s_divergence_limit = 128;
+	private:
+		struct group
+		{
+			// registers, one column per lane
+			alignas(64) i_t i[c::int_reg_count][width] = {};
+			alignas(64) f_t f[c::float_reg_count][width] = {};
+			alignas(64) float vx[c::vec_reg_count][width] = {}, vy[c::vec_reg_count][width] = {};
+			script<STACK, RAM>* s[width] = {};
+			script_runtime* rt[width] = {};
+			// program counter of each lane that isn't active
+			size_t lane_pc[width] = {};
+			// lanes that haven't stopped, and the ones running the current instruction
+			uint8_t live[width] = {}, active[width] = {};
+			size_t count = 0;
+			// the instruction the active lanes are on, and the lowest one a waiting lane is on
+			size_t pc = 0, waiting = 0;
+			// live and active lanes, and instructions run since the group was last together
+			size_t alive = 0, on = 0, diverged = 0;
+
+
+			// empties the group (a lane's registers are all loaded when it's added, so the columns can keep whatever they had)
+			void clear()
+			{
+				count = 0;
+				std::fill(std::begin(live), std::end(live), HASL_CAST(uint8_t, false));
+				std::fill(std::begin(active), std::end(active), HASL_CAST(uint8_t, false));
+			}
+			void add(script<STACK, RAM>& lane, script_runtime& runtime)
+			{
+				const size_t k = count++;
+				s[k] = &lane;
+				rt[k] = &runtime;
+				lane_pc[k] = lane.m_context.pc;
+				live[k] = true;
+				load(k);
+			}
+			void run(machine_t& machine, const std::vector<op>& forms)
+			{
+				const std::span<const args> code = s[0]->m_instructions;
+				const size_t n = code.size();
+				schedule();
+				while (alive)
+				{
+					// fell off the end, or caught up with a waiting lane
+					if (pc >= n || pc >= waiting)
+					{
+						for (size_t k = 0; k < count; k++)
+							if (active[k])
+								lane_pc[k] = pc;
+						if (pc >= n)
+							for (size_t k = 0; k < count; k++)
+								if (active[k])
+									stop(k, pc);
+						schedule();
+						continue;
+					}
+					// one lane left, or split up for too long
+					if (alive == 1 || (on * 2 <= alive && ++diverged > s_divergence_limit))
+					{
+						finish(machine);
+						return;
+					}
+
+					const args& a = code[pc];
+					const op form = forms[pc];
+					if (arithmetic(a, form))
+						pc++;
+					else if (!branch(a, form, n))
+						fallback(machine, a, form, n);
+				}
+			}
+		private:
+			// copy lane k's registers between its script and its column
+			void load(size_t k)
+			{
+				const registers& r = s[k]->m_context.regs;
+				for (size_t x = 0; x < c::int_reg_count; x++)
+					i[x][k] = r.i[x];
+				for (size_t x = 0; x < c::float_reg_count; x++)
+					f[x][k] = r.f[x];
+				for (size_t x = 0; x < c::vec_reg_count; x++)
+				{
+					vx[x][k] = r.v[x].x;
+					vy[x][k] = r.v[x].y;
+				}
+			}
+			void store(size_t k)
+			{
+				registers& r = s[k]->m_context.regs;
+				for (size_t x = 0; x < c::int_reg_count; x++)
+					r.i[x] = i[x][k];
+				for (size_t x = 0; x < c::float_reg_count; x++)
+					r.f[x] = f[x][k];
+				for (size_t x = 0; x < c::vec_reg_count; x++)
+					r.v[x] = { vx[x][k], vy[x][k] };
+			}
+			// just the registers a's handler can touch: its slots, and $obj and $oc (used by the engine.obj handlers and spn)
+			void load(size_t k, const args& a)
+			{
+				registers& r = s[k]->m_context.regs;
+				for (size_t n = 0; n < c::command_reg_count; n++)
+				{
+					const size_t x = a.r[n];
+					switch (a.type(n))
+					{
+					case reg_type::I: i[x][k] = r.i[x]; break;
+					case reg_type::F: f[x][k] = r.f[x]; break;
+					case reg_type::V: vx[x][k] = r.v[x].x; vy[x][k] = r.v[x].y; break;
+					default: break;
+					}
+				}
+				i[c::reg_obj][k] = r.i[c::reg_obj];
+				i[c::reg_oc][k] = r.i[c::reg_oc];
+			}
+			void store(size_t k, const args& a)
+			{
+				registers& r = s[k]->m_context.regs;
+				for (size_t n = 0; n < c::command_reg_count; n++)
+				{
+					const size_t x = a.r[n];
+					switch (a.type(n))
+					{
+					case reg_type::I: r.i[x] = i[x][k]; break;
+					case reg_type::F: r.f[x] = f[x][k]; break;
+					case reg_type::V: r.v[x] = { vx[x][k], vy[x][k] }; break;
+					default: break;
+					}
+				}
+				r.i[c::reg_obj] = i[c::reg_obj][k];
+				r.i[c::reg_oc] = i[c::reg_oc][k];
+			}
+			// lane k stopped, leaving its program counter at pc
+			void stop(size_t k, size_t at)
+			{
+				store(k);
+				s[k]->m_context.pc = at;
+				live[k] = false;
+				active[k] = false;
+			}
+			// the lanes furthest behind go next
+			void schedule()
+			{
+				pc = std::numeric_limits<size_t>::max();
+				waiting = std::numeric_limits<size_t>::max();
+				alive = on = 0;
+				for (size_t k = 0; k < count; k++)
+					if (live[k])
+					{
+						alive++;
+						pc = std::min(pc, lane_pc[k]);
+					}
+				for (size_t k = 0; k < width; k++)
+				{
+					active[k] = live[k] && lane_pc[k] == pc;
+					on += active[k];
+					if (live[k] && !active[k])
+						waiting = std::min(waiting, lane_pc[k]);
+				}
+				if (on == alive)
+					diverged = 0;
+			}
+			// runs every lane that's still going in the interpreter
+			void finish(machine_t& machine)
+			{
+				for (size_t k = 0; k < count; k++)
+				{
+					if (!live[k])
+						continue;
+					stop(k, active[k] ? pc : lane_pc[k]);
+					machine.template execute<false>(*s[k], *rt[k], std::numeric_limits<int64_t>::max());
+				}
+				alive = 0;
+			}
+			// d[k] = fn(k) in every active lane (and in dead ones too, when that keeps the loop unmasked)
+			template<typename T, typename FN>
+			HASL_INLINE void each(T* const d, FN fn)
+			{
+				if (on == alive)
+					for (size_t k = 0; k < width; k++)
+						d[k] = fn(k);
+				else
+					for (size_t k = 0; k < width; k++)
+						d[k] = active[k] ? fn(k) : d[k];
+			}
+			// column of the register in slot n (only indexed by the forms that have one there, since the index may be for another file)
+#define LI(n) i[r[n]]
+#define LF(n) f[r[n]]
+#define LX(n) vx[r[n]]
+#define LY(n) vy[r[n]]
+			// runs a across the group if it's arithmetic or a move
+			HASL_INLINE bool arithmetic(const args& a, op form)
+			{
+				const size_t r[] = { a.r[0], a.r[1], a.r[2] };
+				const i_t ii = a.ii;
+				const f_t fi = a.fi;
+				const float fv = HASL_CAST(float, a.fi);
+
+				// int and float: slot 0 <op> (slot 1 | immediate) into slot 2
+#define QI(name, expr) \
+	case op::name##_r: each(LI(2), [&](size_t k) { const i_t x = LI(0)[k]; const i_t y = LI(1)[k]; return (expr); }); return true; \
+	case op::name##_i: each(LI(2), [&](size_t k) { const i_t x = LI(0)[k]; const i_t y = ii; return (expr); }); return true;
+#define QF(name, expr) \
+	case op::name##_r: each(LF(2), [&](size_t k) { const f_t x = LF(0)[k]; const f_t y = LF(1)[k]; return (expr); }); return true; \
+	case op::name##_i: each(LF(2), [&](size_t k) { const f_t x = LF(0)[k]; const f_t y = fi; return (expr); }); return true;
+#define QFU(name, expr) \
+	case op::name##_r: each(LF(1), [&](size_t k) { const f_t x = LF(0)[k]; return (expr); }); return true; \
+	case op::name##_i: { const f_t x = fi; const f_t y = (expr); each(LF(1), [&](size_t k) { return y; }); return true; }
+				// vec: slot 0 <op> (vec | float | immediate) into slot 2
+#define QV(name, o) \
+	case op::name##_v: \
+		each(LX(2), [&](size_t k) { return LX(0)[k] o LX(1)[k]; }); \
+		each(LY(2), [&](size_t k) { return LY(0)[k] o LY(1)[k]; }); \
+		return true; \
+	case op::name##_f: \
+		each(LX(2), [&](size_t k) { return LX(0)[k] o HASL_CAST(float, LF(1)[k]); }); \
+		each(LY(2), [&](size_t k) { return LY(0)[k] o HASL_CAST(float, LF(1)[k]); }); \
+		return true; \
+	case op::name##_i: \
+		each(LX(2), [&](size_t k) { return LX(0)[k] o fv; }); \
+		each(LY(2), [&](size_t k) { return LY(0)[k] o fv; }); \
+		return true;
+
+				switch (form)
+				{
+				QI(add, x + y)
+				QI(sub, x - y)
+				QI(mul, x * y)
+				QI(band, x & y)
+				QI(bxor, x ^ y)
+				QI(bor, x | y)
+				QI(min, std::min(x, y))
+				QI(max, std::max(x, y))
+				QF(addf, x + y)
+				QF(subf, x - y)
+				QF(mulf, x * y)
+				QF(divf, x / y)
+				QF(minf, std::min(x, y))
+				QF(maxf, std::max(x, y))
+				QFU(squareroot, std::sqrt(x))
+				QFU(absolutef, std::abs(x))
+				QV(addv, +)
+				QV(subv, -)
+				QV(mulv, *)
+				QV(divv, /)
+				case op::mov_i:		each(LI(1), [&](size_t k) { return LI(0)[k]; }); return true;
+				case op::mov_f:		each(LI(1), [&](size_t k) { return HASL_CAST(i_t, LF(0)[k]); }); return true;
+				case op::mov_m:		each(LI(1), [&](size_t k) { return ii; }); return true;
+				case op::movf_i:	each(LF(1), [&](size_t k) { return HASL_CAST(f_t, LI(0)[k]); }); return true;
+				case op::movf_f:	each(LF(1), [&](size_t k) { return LF(0)[k]; }); return true;
+				case op::movf_m:	each(LF(1), [&](size_t k) { return fi; }); return true;
+				case op::movv_v:
+					each(LX(1), [&](size_t k) { return LX(0)[k]; });
+					each(LY(1), [&](size_t k) { return LY(0)[k]; });
+					return true;
+				case op::movv_i:
+					each(LX(1), [&](size_t k) { return HASL_CAST(float, HASL_CAST(f_t, LI(0)[k])); });
+					each(LY(1), [&](size_t k) { return HASL_CAST(float, HASL_CAST(f_t, LI(0)[k])); });
+					return true;
+				case op::movv_f:
+					each(LX(1), [&](size_t k) { return HASL_CAST(float, LF(0)[k]); });
+					each(LY(1), [&](size_t k) { return HASL_CAST(float, LF(0)[k]); });
+					return true;
+				case op::movv_m:
+					each(LX(1), [&](size_t k) { return fv; });
+					each(LY(1), [&](size_t k) { return fv; });
+					return true;
+				case op::absolutev:
+					each(LX(1), [&](size_t k) { return std::abs(LX(0)[k]); });
+					each(LY(1), [&](size_t k) { return std::abs(LY(0)[k]); });
+					return true;
+				case op::minv:		each(LF(1), [&](size_t k) { return HASL_CAST(f_t, std::min(LX(0)[k], LY(0)[k])); }); return true;
+				case op::maxv:		each(LF(1), [&](size_t k) { return HASL_CAST(f_t, std::max(LX(0)[k], LY(0)[k])); }); return true;
+				case op::dot:		each(LF(2), [&](size_t k) { return HASL_CAST(f_t, LX(0)[k] * LX(1)[k] + LY(0)[k] * LY(1)[k]); }); return true;
+				case op::mag:		each(LF(1), [&](size_t k) { return HASL_CAST(f_t, std::sqrt(LX(0)[k] * LX(0)[k] + LY(0)[k] * LY(0)[k])); }); return true;
+#if HASL_STRICT_FP
+				// otherwise vec::normalized uses an estimate the lanes can't reproduce, so each lane runs the handler instead
+				case op::norm:
+				{
+					// the source and destination may be the same register
+					float m[width];
+					for (size_t k = 0; k < width; k++)
+						m[k] = std::sqrt(LX(0)[k] * LX(0)[k] + LY(0)[k] * LY(0)[k]);
+					each(LX(1), [&](size_t k) { return LX(0)[k] / m[k]; });
+					each(LY(1), [&](size_t k) { return LY(0)[k] / m[k]; });
+					return true;
+				}
+#endif
+				default:
+					return false;
+				}
+#undef QV
+#undef QFU
+#undef QF
+#undef QI
+			}
+			// runs a across the group if it's a branch (to a label in range), and moves the active lanes to wherever it sends them
+			HASL_INLINE bool branch(const args& a, op form, size_t n)
+			{
+				if (a.ii < 0 || HASL_CAST(size_t, a.ii) >= n)
+					return false;
+				const size_t target = HASL_CAST(size_t, a.ii);
+				if (form == op::j)
+				{
+					pc = target;
+					return true;
+				}
+
+				const size_t r[] = { a.r[0], a.r[1] };
+				uint8_t taken[width];
+				auto test = [&](auto cond)
+				{
+					for (size_t k = 0; k < width; k++)
+						taken[k] = cond(k);
+				};
+				switch (form)
+				{
+				case op::beq_i:		test([&](size_t k) { return LI(0)[k] == LI(1)[k]; }); break;
+				case op::bne_i:		test([&](size_t k) { return LI(0)[k] != LI(1)[k]; }); break;
+				case op::blt_i:		test([&](size_t k) { return LI(0)[k] < LI(1)[k]; }); break;
+				case op::bgt_i:		test([&](size_t k) { return LI(0)[k] > LI(1)[k]; }); break;
+				case op::ble_i:		test([&](size_t k) { return LI(0)[k] <= LI(1)[k]; }); break;
+				case op::bge_i:		test([&](size_t k) { return LI(0)[k] >= LI(1)[k]; }); break;
+				case op::beqz_i:	test([&](size_t k) { return LI(0)[k] == 0; }); break;
+				case op::beq_f:		test([&](size_t k) { return LF(0)[k] == LF(1)[k]; }); break;
+				case op::bne_f:		test([&](size_t k) { return LF(0)[k] != LF(1)[k]; }); break;
+				case op::blt_f:		test([&](size_t k) { return LF(0)[k] < LF(1)[k]; }); break;
+				case op::bgt_f:		test([&](size_t k) { return LF(0)[k] > LF(1)[k]; }); break;
+				case op::ble_f:		test([&](size_t k) { return LF(0)[k] <= LF(1)[k]; }); break;
+				case op::bge_f:		test([&](size_t k) { return LF(0)[k] >= LF(1)[k]; }); break;
+				case op::beqz_f:	test([&](size_t k) { return LF(0)[k] == 0; }); break;
+				case op::beq_v:		test([&](size_t k) { return LX(0)[k] == LX(1)[k] && LY(0)[k] == LY(1)[k]; }); break;
+				case op::bne_v:		test([&](size_t k) { return LX(0)[k] != LX(1)[k] || LY(0)[k] != LY(1)[k]; }); break;
+				case op::beqz_v:	test([&](size_t k) { return LX(0)[k] == 0.f && LY(0)[k] == 0.f; }); break;
+				default:
+					return false;
+				}
+
+				size_t yes = 0;
+				for (size_t k = 0; k < width; k++)
+					yes += taken[k] & active[k];
+				if (yes == 0)
+					pc++;
+				else if (yes == on)
+					pc = target;
+				else
+				{
+					for (size_t k = 0; k < width; k++)
+						if (active[k])
+							lane_pc[k] = taken[k] ? target : pc + 1;
+					schedule();
+				}
+				return true;
+			}
+#undef LY
+#undef LX
+#undef LF
+#undef LI
+			// runs a's handler on each active lane's own script
+			void fallback(machine_t& machine, const args& a, op form, size_t n)
+			{
+				const operation fn = handler(HASL_CAST(uint16_t, form));
+				size_t next = std::numeric_limits<size_t>::max();
+				bool together = true;
+				for (size_t k = 0; k < count; k++)
+				{
+					if (!active[k])
+						continue;
+					context<STACK>& ctx = s[k]->m_context;
+					store(k, a);
+					ctx.pc = pc;
+					(machine.*fn)(s[k], a, *rt[k]);
+					load(k, a);
+
+					// like the interpreter, a lane that stops is left after the instruction that stopped it
+					const size_t to = ctx.pc + 1;
+					if (ctx.abort || to >= n)
+					{
+						stop(k, to);
+						together = false;
+						continue;
+					}
+					lane_pc[k] = to;
+					together &= (next == std::numeric_limits<size_t>::max() || next == to);
+					next = to;
+				}
+
+				if (together)
+					pc = next;
+				else
+					schedule();
+			}
+		};
+	private:
+		// whether a and b run the same instructions
+		static bool same_program(const script<STACK, RAM>& a, const script<STACK, RAM>& b)
+		{
+			if (a.m_program == b.m_program)
+				return true;
+			const std::span<const args> x = a.get_instructions();
+			const std::span<const args> y = b.get_instructions();
+			if (a.get_entry_point() != b.get_entry_point() || x.size() != y.size())
+				return false;
+			for (size_t i = 0; i < x.size(); i++)
+				if (x[i].encode() != y[i].encode() || x[i].ii != y[i].ii)
+					return false;
+			return true;
+		}
+		static operation handler(uint16_t h)
+		{
+#define X(name) &machine_t::name,
+			const static operation handlers[] = { HASL_SASM_HANDLERS(X) HASL_SASM_QUICK_HANDLERS(X) };
+#undef X
+			return handlers[h];
+		}
+	};
+}
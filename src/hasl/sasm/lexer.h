@@ -0,0 +1,114 @@
+#pragma once
+#include "pch.h"
+
+namespace hasl::sasm
+{
+	// splits a script's source into lines of a command and its arguments. tokens are views into the source, which has to outlive them, so
+	// nothing is allocated per line
+	class lexer
+	{
+	public:
+		struct token
+		{
+			std::string_view text;
+			// 1-based, for errors
+			size_t column;
+		};
+		struct line
+		{
+			size_t number;
+			token command;
+			// everything after the command, for checking that a label is on its own line
+			std::string_view rest;
+			// the first c::command_reg_count non-empty arguments, though count is how many there were
+			token args[c::command_reg_count];
+			size_t count;
+		};
+	public:
+		lexer(std::string_view source) :
+			m_source(source),
+			m_at(0),
+			m_line(0)
+		{}
+		HASL_DCM(lexer);
+	public:
+		// the next line that isn't empty or a comment, or false at the end of the source
+		bool next(line* const l)
+		{
+			while (m_at < m_source.size())
+			{
+				size_t end = m_source.find('\n', m_at);
+				if (end == std::string_view::npos)
+					end = m_source.size();
+				const size_t start = m_at;
+				m_at = end + 1;
+				m_line++;
+
+				// files saved with \r\n line endings
+				std::string_view text = m_source.substr(start, end - start);
+				if (!text.empty() && text.back() == '\r')
+					text.remove_suffix(1);
+				const size_t column = trim(&text) + 1;
+				if (text.empty() || text[0] == c::comment_token)
+					continue;
+
+				l->number = m_line;
+				const size_t space = std::min(text.find_first_of(hasl::c::whitespace_tokens), text.size());
+				l->command = { text.substr(0, space), column };
+				l->rest = text.substr(space);
+				const size_t rest_column = column + space + trim(&l->rest);
+				split(l, rest_column);
+				return true;
+			}
+			return false;
+		}
+	private:
+		std::string_view m_source;
+		size_t m_at, m_line;
+	private:
+		// removes whitespace from both ends of s, returning how much was removed from the front
+		static size_t trim(std::string_view* const s)
+		{
+			const size_t start = s->find_first_not_of(hasl::c::whitespace_tokens);
+			if (start == std::string_view::npos)
+			{
+				const size_t size = s->size();
+				*s = {};
+				return size;
+			}
+			s->remove_prefix(start);
+			s->remove_suffix(s->size() - s->find_last_not_of(hasl::c::whitespace_tokens) - 1);
+			return start;
+		}
+		// splits the arguments at separators outside of string literals, skipping empty ones
+		static void split(line* const l, size_t column)
+		{
+			l->count = 0;
+			if (l->rest.empty())
+				return;
+
+			bool in_string = false;
+			size_t last = 0;
+			for (size_t i = 0; i <= l->rest.size(); i++)
+			{
+				if (i < l->rest.size())
+				{
+					if (l->rest[i] == hasl::c::string_token)
+						in_string = !in_string;
+					if (in_string || l->rest[i] != hasl::c::list_separator_token)
+						continue;
+				}
+
+				std::string_view arg = l->rest.substr(last, i - last);
+				const size_t arg_column = column + last + trim(&arg);
+				if (!arg.empty())
+				{
+					if (l->count < c::command_reg_count)
+						l->args[l->count] = { arg, arg_column };
+					l->count++;
+				}
+				last = i + 1;
+			}
+		}
+	};
+}
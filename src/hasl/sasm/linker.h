@@ -0,0 +1,177 @@
+#pragma once
+#include "pch.h"
+#include "script.h"
+#include "verifier.h"
+
+namespace hasl::sasm
+{
+	// links modules (assembled or deserialized programs) into one image of instructions, so code they share (steering, pathing, dialogue...)
+	// is in memory once for every script that uses it. each module's code is placed after the one before it, with its labels and string
+	// literals moved to match, and every label a module imports is resolved to the module that exports it. each module with a main label
+	// gets a program that runs from the image and keeps it alive, which every script made by instantiate for it shares. numbers used as
+	// branch targets aren't moved, so modules should branch to labels
+	template<size_t STACK, size_t RAM>
+	class linker
+	{
+	public:
+		linker() {}
+		HASL_DCM(linker);
+	public:
+		// adds s's program as a module under name (it's kept until the linker is destroyed)
+		void add(const std::string& name, const script<STACK, RAM>* const s)
+		{
+			m_modules.push_back({ name, s ? s->m_program : nullptr });
+		}
+		// lays out every module added in one image and resolves their imports. returns false (having printed why) if a module failed to
+		// assemble, two modules have the same name or export the same label, an import isn't exported by any module, or the string literals
+		// don't fit in RAM together
+		bool link()
+		{
+			typedef vm<STACK, RAM> machine;
+			machine::initialize();
+			auto image = std::make_shared<std::vector<args>>();
+
+			// where each module's code and string literals go, and every label exported
+			std::unordered_map<std::string, size_t> exports;
+			size_t data_address = RAM;
+			for (module& m : m_modules)
+			{
+				if (!m.source || !m.source->is_assembled())
+				{
+					printf("Can't link module '%s', it failed to assemble\n", m.name.c_str());
+					return false;
+				}
+				if (find(m.name) != &m)
+				{
+					printf("Module '%s' is linked twice\n", m.name.c_str());
+					return false;
+				}
+				const program<STACK, RAM>& p = *m.source;
+				m.base = image->size();
+				m.entry_point = m.base + p.m_entry_point;
+				m.runnable = std::any_of(p.m_labels.begin(), p.m_labels.end(), [](const auto& l) { return l.second == c::entry_point_token; });
+
+				const size_t data_size = p.m_data.bytes.size();
+				if (data_size > data_address)
+				{
+					printf("String literals in linked modules don't fit in RAM\n");
+					return false;
+				}
+				data_address -= data_size;
+				m.data_delta = HASL_CAST(i_t, data_address) - HASL_CAST(i_t, p.m_data.address);
+
+				image->insert(image->end(), p.m_instructions.begin(), p.m_instructions.end());
+				// so a module that runs off its end stops instead of running into the next one
+				args end;
+				end.opcode = machine::s_command_descriptions.at("end").opcode;
+				end.handler = machine::quicken(end);
+				image->push_back(end);
+
+				for (const auto& [pc, label] : p.m_symbols.exports)
+				{
+					if (!exports.emplace(label, m.base + pc).second)
+					{
+						printf("Label '%s' is exported by more than one module\n", label.c_str());
+						return false;
+					}
+				}
+			}
+
+			// the string literals, each module's below the one before it
+			m_data = { data_address, std::vector<uint8_t>(RAM - data_address) };
+			m_labels.clear();
+			for (const module& m : m_modules)
+			{
+				const program<STACK, RAM>& p = *m.source;
+				const std::vector<uint8_t>& bytes = p.m_data.bytes;
+				std::copy(bytes.begin(), bytes.end(), m_data.bytes.begin() + (p.m_data.address + m.data_delta - data_address));
+				for (const auto& [pc, label] : p.m_labels)
+					m_labels.emplace_back(m.base + pc, m.name + "." + label);
+
+				args* const code = image->data() + m.base;
+				for (const relocation& r : p.m_symbols.relocations)
+					code[r.index].ii += r.target == relocation::CODE ? HASL_CAST(i_t, m.base) : m.data_delta;
+				for (const auto& [index, label] : p.m_symbols.imports)
+				{
+					const auto& it = exports.find(label);
+					if (it == exports.end())
+					{
+						printf("Label '%s' imported by module '%s' isn't exported by any module\n", label.c_str(), m.name.c_str());
+						return false;
+					}
+					code[index].ii = HASL_CAST(i_t, it->second);
+				}
+			}
+			std::sort(m_labels.begin(), m_labels.end());
+
+			// the modules' own verification doesn't hold for the image, so their handlers are picked again and the image is verified from every
+			// module that can run
+			for (args& a : *image)
+				a.handler = machine::quicken(a);
+			std::vector<size_t> entries;
+			for (const module& m : m_modules)
+				if (m.runnable)
+					entries.push_back(m.entry_point);
+			const std::vector<size_t> needs = verifier<STACK, RAM>::verify(*image, entries);
+			for (size_t i = 0, j = 0; i < m_modules.size(); i++)
+			{
+				module& m = m_modules[i];
+				m.linked.reset();
+				if (!m.runnable)
+					continue;
+				m.linked = std::make_shared<program<STACK, RAM>>(m.entry_point, std::span<args>(*image), needs[j++], m_labels, m_data,
+					symbol_table(), image, m.source->m_filepath.c_str());
+			}
+
+			m_image = std::move(image);
+			return true;
+		}
+		// a new script that runs the main label of the module called name from the image, with every module's string literals written to vm's
+		// RAM. every script made for a module shares its program. returns nullptr if there's no such module, it has no main label, or link
+		// hasn't succeeded
+		template<typename T = script<STACK, RAM>>
+		T* instantiate(const std::string& name, vm<STACK, RAM>* const vm) const
+		{
+			const module* const m = find(name);
+			if (!m_image || !m || !m->linked)
+			{
+				printf("No linked module '%s' with a '%s' label\n", name.c_str(), c::entry_point_token);
+				return nullptr;
+			}
+			if (vm)
+				vm->load_data(m_data);
+			return new T(m->linked);
+		}
+		// instructions in the image (0 until link succeeds)
+		size_t size() const
+		{
+			return m_image ? m_image->size() : 0;
+		}
+	private:
+		struct module
+		{
+			std::string name;
+			std::shared_ptr<const program<STACK, RAM>> source;
+			// where its code starts in the image, where it starts running, and how far its string literals moved
+			size_t base = 0, entry_point = 0;
+			i_t data_delta = 0;
+			// it has a main label, so it can be run from linked
+			bool runnable = false;
+			std::shared_ptr<program<STACK, RAM>> linked;
+		};
+	private:
+		std::vector<module> m_modules;
+		std::shared_ptr<std::vector<args>> m_image;
+		// every module's labels, as "module.label"
+		std::vector<std::pair<size_t, std::string>> m_labels;
+		data_segment m_data;
+	private:
+		const module* find(const std::string& name) const
+		{
+			for (const module& m : m_modules)
+				if (m.name == name)
+					return &m;
+			return nullptr;
+		}
+	};
+}
@@ -0,0 +1,344 @@
+#pragma once
+#include "pch.h"
+#include "vm.h"
+
+namespace hasl::sasm
+{
+	// counts what the scripts run on a vm do while it's set with vm::set_profiler: how often each instruction runs, in which subroutine (by the
+	// chain of calls that got there), and how long each program's runs take, added up over every script that runs it. time is only measured
+	// per run, so the time given to a label or a block is its program's time split by how many instructions ran there
+	template<size_t STACK, size_t RAM>
+	class profiler
+	{
+		friend class vm<STACK, RAM>;
+	public:
+		profiler() {}
+		HASL_DCM(profiler);
+	public:
+		// forgets everything counted so far
+		void clear()
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			m_records.clear();
+			m_current.clear();
+		}
+		// prints the programs that took longest, then the instructions, labels, opcodes, and basic blocks that ran the most (the first `top` of
+		// each)
+		void report(FILE* const out = stdout, size_t top = 10) const
+		{
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const auto held = hold_all();
+
+			std::vector<summary> all;
+			uint64_t instructions = 0;
+			double seconds = 0;
+			for (const auto& it : m_records)
+			{
+				all.push_back(summarize(it.second));
+				instructions += all.back().instructions;
+				seconds += it.second.seconds;
+			}
+			fprintf(out, "\n== SASM PROFILE: %zu programs, %llu instructions, %.3f ms ==\n", all.size(), HASL_CAST(unsigned long long, instructions),
+				seconds * 1000);
+
+			std::vector<const summary*> scripts;
+			for (const summary& s : all)
+				scripts.push_back(&s);
+			keep_top(scripts, top, [](const summary* s) { return s->r->seconds; });
+			fprintf(out, "\n-- programs --\n%10s %7s %9s %14s %9s  %s\n", "ms", "time", "runs", "instructions", "ns/instr", "script");
+			for (const summary* s : scripts)
+				fprintf(out, "%10.3f %6.1f%% %9llu %14llu %9.1f  %s\n", s->r->seconds * 1000, percent(s->r->seconds, seconds),
+					HASL_CAST(unsigned long long, s->r->runs), HASL_CAST(unsigned long long, s->instructions),
+					s->instructions ? s->r->seconds * 1e9 / s->instructions : 0., s->r->name.c_str());
+
+			std::vector<place> hot;
+			for (const summary& s : all)
+				for (size_t pc = 0; pc < s.counts.size(); pc++)
+					if (s.counts[pc])
+						hot.push_back({ &s, pc, pc + 1, s.counts[pc] });
+			keep_top(hot, top, [](const place& p) { return p.instructions; });
+			fprintf(out, "\n-- instructions --\n%14s %7s  %-8s %-24s %s\n", "runs", "instr", "opcode", "at", "script");
+			for (const place& p : hot)
+				fprintf(out, "%14llu %6.1f%%  %-8s %-24s %s\n", HASL_CAST(unsigned long long, p.instructions), percent(p.instructions, instructions),
+					machine::handler_name(p.s->r->code[p.begin].opcode), p.s->r->where(p.begin).c_str(), p.s->r->name.c_str());
+
+			std::vector<place> labels;
+			for (const summary& s : all)
+			{
+				const auto& l = s.r->labels;
+				// code before the first label counts as its own region
+				size_t begin = 0;
+				for (size_t i = 0; i <= l.size(); i++)
+				{
+					const size_t end = i < l.size() ? l[i].first : s.counts.size();
+					if (end > begin)
+						labels.push_back({ &s, begin, end, sum(s.counts, begin, end) });
+					begin = std::max(begin, end);
+				}
+			}
+			keep_top(labels, top, [](const place& p) { return p.instructions; });
+			print_places(out, "labels", labels, instructions);
+
+			std::vector<uint64_t> opcodes(machine::s_opcode_count, 0);
+			for (const summary& s : all)
+				for (size_t pc = 0; pc < s.counts.size(); pc++)
+					opcodes[s.r->code[pc].opcode] += s.counts[pc];
+			std::vector<size_t> order;
+			for (size_t i = 0; i < opcodes.size(); i++)
+				if (opcodes[i])
+					order.push_back(i);
+			keep_top(order, top, [&](size_t i) { return opcodes[i]; });
+			fprintf(out, "\n-- opcodes --\n%14s %7s  %s\n", "runs", "instr", "opcode");
+			for (size_t i : order)
+				fprintf(out, "%14llu %6.1f%%  %s\n", HASL_CAST(unsigned long long, opcodes[i]), percent(opcodes[i], instructions),
+					machine::handler_name(HASL_CAST(uint16_t, i)));
+
+			std::vector<place> blocks;
+			for (const summary& s : all)
+			{
+				const std::vector<bool> leaders = find_leaders(*s.r);
+				for (size_t begin = 0, end = 1; begin < s.counts.size(); begin = end++)
+				{
+					while (end < s.counts.size() && !leaders[end])
+						end++;
+					if (s.counts[begin])
+						blocks.push_back({ &s, begin, end, sum(s.counts, begin, end) });
+				}
+			}
+			keep_top(blocks, top, [](const place& p) { return p.instructions; });
+			print_places(out, "blocks", blocks, instructions);
+		}
+		// writes the instructions run under each call path in the "collapsed stack" format flamegraph tools read, one `script;routine;...;label
+		// count` line each (the last frame is left out when it's the routine's own label). returns false if fp couldn't be opened
+		bool write_collapsed(const char* const fp) const
+		{
+			std::ofstream out(fp);
+			if (!out.is_open())
+			{
+				printf("Error opening profile output file '%s'\n", fp);
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const auto held = hold_all();
+			std::map<std::string, uint64_t> stacks;
+			for (const auto& it : m_records)
+			{
+				const record& r = it.second;
+				for (size_t i = 0; i < r.frames.size(); i++)
+				{
+					const frame& f = r.frames[i];
+					std::string path = r.where(f.entry);
+					for (size_t j = i; j; j = r.frames[j].parent)
+						path = r.where(r.frames[r.frames[j].parent].entry) + ";" + path;
+					path = r.name + ";" + path;
+
+					const auto* const own = r.label_at(f.entry);
+					for (size_t pc = 0; pc < f.counts.size(); pc++)
+					{
+						if (!f.counts[pc])
+							continue;
+						const auto* const label = r.label_at(pc);
+						stacks[label && label != own ? path + ";" + label->second : path] += f.counts[pc];
+					}
+				}
+			}
+
+			for (const auto& it : stacks)
+				out << it.first << " " << it.second << "\n";
+			return true;
+		}
+	private:
+		typedef vm<STACK, RAM> machine;
+		typedef typename machine::op op;
+		// a subroutine, as reached by one chain of calls
+		struct frame
+		{
+			size_t parent, entry;
+			// runs of each instruction while in this frame
+			std::vector<uint64_t> counts;
+			// entry of each routine called from here -> its frame
+			std::unordered_map<size_t, size_t> callees;
+		};
+		// everything counted for one program, by every script that runs it
+		struct record
+		{
+			// copied from the program, so it doesn't have to outlive the profiler
+			std::string name;
+			std::vector<args> code;
+			std::vector<std::pair<size_t, std::string>> labels;
+			// frames[0] is the entry point's
+			std::vector<frame> frames;
+			uint64_t runs = 0;
+			double seconds = 0;
+			// held for each run counted here, since scripts running the program on other threads (vm::run_batch) count here too
+			mutable std::mutex mutex;
+			// the last label at or before pc, or nullptr
+			const std::pair<size_t, std::string>* label_at(size_t pc) const
+			{
+				const auto& it = std::upper_bound(labels.begin(), labels.end(), pc,
+					[](size_t pc, const std::pair<size_t, std::string>& l) { return pc < l.first; });
+				return it == labels.begin() ? nullptr : &*(it - 1);
+			}
+			// pc as label+offset (or @pc before the first label)
+			std::string where(size_t pc) const
+			{
+				const auto* const label = label_at(pc);
+				if (!label)
+					return "@" + std::to_string(pc);
+				return pc == label->first ? label->second : label->second + "+" + std::to_string(pc - label->first);
+			}
+		};
+		// a run being counted, which has its program's record to itself until it's destroyed
+		struct run
+		{
+			std::unique_lock<std::mutex> lock;
+			record* rec;
+			// the frame its script is in, kept between runs so a preempted or sleeping one carries on where it was
+			size_t* current;
+
+			HASL_INLINE void count(size_t pc)
+			{
+				rec->frames[*current].counts[pc]++;
+			}
+			void enter(size_t target)
+			{
+				std::vector<frame>& frames = rec->frames;
+				const auto& it = frames[*current].callees.find(target);
+				if (it != frames[*current].callees.end())
+				{
+					*current = it->second;
+					return;
+				}
+				frames[*current].callees.emplace(target, frames.size());
+				frames.push_back({ *current, target, std::vector<uint64_t>(rec->code.size(), 0), {} });
+				*current = frames.size() - 1;
+			}
+			void leave()
+			{
+				// a ret from the entry point's frame (which stops the script) leaves it where it is
+				*current = rec->frames[*current].parent;
+			}
+		};
+		// a record's counts, added up over its frames
+		struct summary
+		{
+			const record* r;
+			std::vector<uint64_t> counts;
+			uint64_t instructions;
+		};
+		// a range of a program's instructions
+		struct place
+		{
+			const summary* s;
+			size_t begin, end;
+			uint64_t instructions;
+		};
+	private:
+		mutable std::mutex m_mutex;
+		// by program, and the frame each script is in. neither is assumed to be destroyed (with another made in its place) while counting
+		std::unordered_map<const program<STACK, RAM>*, record> m_records;
+		std::unordered_map<const script<STACK, RAM>*, size_t> m_current;
+	private:
+		// a run of s, counted in its program's record. a run that isn't resuming starts over in the entry point's frame
+		run begin(const script<STACK, RAM>& s, bool resumed)
+		{
+			const program<STACK, RAM>& p = *s.m_program;
+			record* r;
+			size_t* current;
+			{
+				std::lock_guard<std::mutex> lock(m_mutex);
+				// elements stay where they are when others are added
+				r = &m_records[&p];
+				current = &m_current[&s];
+			}
+
+			std::unique_lock<std::mutex> lock(r->mutex);
+			if (r->frames.empty())
+			{
+				r->name = p.m_filepath.empty() ? "?" : p.m_filepath;
+				r->code.assign(p.m_instructions.begin(), p.m_instructions.end());
+				r->labels = p.m_labels;
+				r->frames.push_back({ 0, p.m_entry_point, std::vector<uint64_t>(p.m_instructions.size(), 0), {} });
+			}
+			if (!resumed)
+				*current = 0;
+			r->runs++;
+			return { std::move(lock), r, current };
+		}
+		// every record's lock, so nothing is counted while they're read
+		std::vector<std::unique_lock<std::mutex>> hold_all() const
+		{
+			std::vector<std::unique_lock<std::mutex>> held;
+			for (const auto& it : m_records)
+				held.emplace_back(it.second.mutex);
+			return held;
+		}
+		static summary summarize(const record& r)
+		{
+			summary s = { &r, std::vector<uint64_t>(r.code.size(), 0), 0 };
+			for (const frame& f : r.frames)
+				for (size_t pc = 0; pc < f.counts.size(); pc++)
+					s.counts[pc] += f.counts[pc];
+			s.instructions = sum(s.counts, 0, s.counts.size());
+			return s;
+		}
+		// instructions that start a basic block: labels, branch targets, and whatever follows an instruction that can move the program counter
+		static std::vector<bool> find_leaders(const record& r)
+		{
+			std::vector<bool> leaders(r.code.size() + 1, false);
+			leaders[0] = true;
+			for (const auto& label : r.labels)
+				leaders[label.first] = true;
+			for (size_t pc = 0; pc < r.code.size(); pc++)
+			{
+				const args& a = r.code[pc];
+				if (!machine::is_control(a))
+					continue;
+				leaders[pc + 1] = true;
+				switch (HASL_CAST(op, a.opcode))
+				{
+				case op::beq: case op::beqz: case op::bne: case op::blt: case op::bgt: case op::ble: case op::bge: case op::j: case op::call:
+					if (a.ii >= 0 && HASL_CAST(size_t, a.ii) < r.code.size())
+						leaders[HASL_CAST(size_t, a.ii)] = true;
+					break;
+				default:
+					break;
+				}
+			}
+			return leaders;
+		}
+		static uint64_t sum(const std::vector<uint64_t>& counts, size_t begin, size_t end)
+		{
+			uint64_t n = 0;
+			for (size_t i = begin; i < end; i++)
+				n += counts[i];
+			return n;
+		}
+		static double percent(double part, double whole)
+		{
+			return whole > 0 ? part * 100 / whole : 0;
+		}
+		// sorts v by key, largest first, and drops all but the first `top`
+		template<typename T, typename KEY>
+		static void keep_top(std::vector<T>& v, size_t top, KEY key)
+		{
+			const size_t n = std::min(top, v.size());
+			std::partial_sort(v.begin(), v.begin() + n, v.end(), [&](const T& a, const T& b) { return key(a) > key(b); });
+			v.resize(n);
+		}
+		// a table of places, with the share of their script's time the instructions they ran are estimated to have taken
+		static void print_places(FILE* const out, const char* title, const std::vector<place>& places, uint64_t instructions)
+		{
+			fprintf(out, "\n-- %s --\n%14s %7s %10s %6s  %-36s %s\n", title, "executed", "instr", "~ms", "size", "at", "script");
+			for (const place& p : places)
+			{
+				const record& r = *p.s->r;
+				const double ms = p.s->instructions ? r.seconds * 1000 * p.instructions / p.s->instructions : 0;
+				const std::string at = p.end - p.begin > 1 ? r.where(p.begin) + " .. " + r.where(p.end - 1) : r.where(p.begin);
+				fprintf(out, "%14llu %6.1f%% %10.3f %6zu  %-36s %s\n", HASL_CAST(unsigned long long, p.instructions),
+					percent(p.instructions, instructions), ms, p.end - p.begin, at.c_str(), r.name.c_str());
+			}
+		}
+	};
+}
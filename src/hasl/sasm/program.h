@@ -0,0 +1,214 @@
+#pragma once
+#include "pch.h"
+#include "registers.h"
+#include "command.h"
+#include "assembler.h"
+#include "bytecode.h"
+#include "jit.h"
+
+namespace hasl::sasm
+{
+	template<size_t, size_t>
+	class vm;
+	template<size_t, size_t>
+	class script;
+	template<size_t, size_t>
+	class aot;
+	template<size_t, size_t>
+	class lanes;
+	template<size_t, size_t>
+	class verifier;
+	template<size_t, size_t>
+	class profiler;
+	template<size_t, size_t>
+	class script_cache;
+	template<size_t, size_t>
+	class linker;
+
+	// everything about a script that doesn't change while it runs: its decoded instructions, labels, string literals, and the native code
+	// they're compiled to. any number of scripts (one per entity, say) can run one program, each with its own registers and stack (see
+	// script), so it's only assembled, verified, and compiled once however many there are. instructions refer to registers by index and to
+	// RAM by address, so those scripts can run on any vm (and thread) whose RAM has the program's string literals (see vm::load_data)
+	template<size_t STACK, size_t RAM>
+	class program
+	{
+		friend class assembler<STACK, RAM>;
+		friend class vm<STACK, RAM>;
+		friend class script<STACK, RAM>;
+		friend class jit<STACK, RAM>;
+		friend class aot<STACK, RAM>;
+		friend class lanes<STACK, RAM>;
+		friend class verifier<STACK, RAM>;
+		friend class profiler<STACK, RAM>;
+		friend class script_cache<STACK, RAM>;
+		friend class linker<STACK, RAM>;
+	public:
+		// assembles the script at fp and writes its string literals to vm's RAM. vm can be nullptr to only assemble it (to serialize, say), in
+		// which case they're written by whichever vm loads it
+		program(const char* fp, vm<STACK, RAM>* const vm) :
+			m_assembled(false),
+			m_entry_point(0),
+			m_filepath(fp),
+			m_run_count(0),
+			m_jit(nullptr),
+			m_compiling(false)
+		{
+			m_assembled = assembler<STACK, RAM>(fp, this).assemble();
+			if (m_assembled && vm)
+				vm->load_data(m_data);
+			m_instructions = m_owned;
+			m_stack_need = m_assembled ? verifier<STACK, RAM>::verify(*this) : verifier<STACK, RAM>::s_unbounded;
+			m_aot = aot<STACK, RAM>::find(*this);
+		}
+		// name is what it's called where it was loaded from, if anywhere (see get_filepath)
+		program(uint64_t entry_point, const std::vector<args>& instructions, const std::vector<std::pair<size_t, std::string>>& labels = {},
+			const data_segment& data = {}, const symbol_table& symbols = {}, const char* name = "") :
+			m_assembled(true),
+			m_entry_point(entry_point),
+			m_filepath(name),
+			m_owned(instructions),
+			m_instructions(m_owned),
+			m_labels(labels),
+			m_data(data),
+			m_symbols(symbols),
+			m_run_count(0),
+			m_jit(nullptr),
+			m_compiling(false)
+		{
+			m_stack_need = verifier<STACK, RAM>::verify(*this);
+			m_aot = aot<STACK, RAM>::find(*this);
+		}
+		// runs instructions where they are, in storage that the program keeps alive: a file mapped by deserialize, or an image made by linker.
+		// they have to have been verified for this STACK and RAM already, which is what stack_need came from
+		program(uint64_t entry_point, std::span<args> instructions, size_t stack_need, const std::vector<std::pair<size_t, std::string>>& labels,
+			const data_segment& data, const symbol_table& symbols, std::shared_ptr<void> storage, const char* name = "") :
+			m_assembled(true),
+			m_entry_point(entry_point),
+			m_filepath(name),
+			m_instructions(instructions),
+			m_storage(std::move(storage)),
+			m_labels(labels),
+			m_data(data),
+			m_symbols(symbols),
+			m_run_count(0),
+			m_jit(nullptr),
+			m_compiling(false),
+			m_stack_need(stack_need)
+		{
+			m_aot = aot<STACK, RAM>::find(*this);
+		}
+		HASL_DCM(program);
+	public:
+		// false if the source couldn't be read or had errors
+		bool is_assembled() const
+		{
+			return m_assembled;
+		}
+		size_t get_entry_point() const
+		{
+			return m_entry_point;
+		}
+		// the source file it was assembled from, or the name it was loaded or linked under (what dbgs output and the profiler show)
+		const std::string& get_filepath() const
+		{
+			return m_filepath;
+		}
+		std::span<const args> get_instructions() const
+		{
+			return m_instructions;
+		}
+		// most stack slots one run can use, as proven by the verifier (verifier::s_unbounded if it couldn't be)
+		size_t get_stack_need() const
+		{
+			return m_stack_need;
+		}
+		// instruction index and name of each label, in order (empty if the script wasn't assembled from source)
+		const std::vector<std::pair<size_t, std::string>>& get_labels() const
+		{
+			return m_labels;
+		}
+		const data_segment& get_data() const
+		{
+			return m_data;
+		}
+		const symbol_table& get_symbols() const
+		{
+			return m_symbols;
+		}
+		// writes the program for deserialize (out has to be opened in binary mode)
+		void serialize(std::ostream& out) const
+		{
+			bytecode_header h = {};
+			memcpy(h.magic, bytecode_header::s_magic, sizeof(h.magic));
+			h.version = bytecode_header::s_version;
+			h.endian = bytecode_header::s_endian;
+			h.size = sizeof(h);
+			h.fingerprint = vm<STACK, RAM>::handler_fingerprint();
+			h.stack = STACK;
+			h.ram = RAM;
+			h.entry_point = m_entry_point;
+			h.stack_need = m_stack_need;
+			h.instruction_count = m_instructions.size();
+
+			auto names = [](const std::vector<std::pair<size_t, std::string>>& list)
+			{
+				std::string section;
+				for (const auto& [pc, name] : list)
+				{
+					const uint64_t fields[] = { pc, name.size() };
+					section.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+					section += name;
+				}
+				return section;
+			};
+			std::string relocations;
+			for (const relocation& r : m_symbols.relocations)
+			{
+				const uint64_t fields[] = { r.index, r.target };
+				relocations.append(reinterpret_cast<const char*>(fields), sizeof(fields));
+			}
+			// the instructions follow the header, which keeps them aligned, and the other sections follow them in order
+			const std::string sections[] =
+			{
+				std::string(), names(m_labels), std::string(reinterpret_cast<const char*>(m_data.bytes.data()), m_data.bytes.size()), relocations,
+				names(m_symbols.imports), names(m_symbols.exports)
+			};
+			h.sections[bytecode_header::CODE] = { sizeof(h), m_instructions.size_bytes() };
+			for (size_t i = bytecode_header::CODE + 1; i < bytecode_header::SECTION_COUNT; i++)
+				h.sections[i] = { h.sections[i - 1].offset + h.sections[i - 1].size, sections[i].size() };
+			h.data_address = m_data.address;
+
+			out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+			out.write(reinterpret_cast<const char*>(m_instructions.data()), m_instructions.size_bytes());
+			for (const std::string& section : sections)
+				out.write(section.data(), section.size());
+		}
+	private:
+		bool m_assembled;
+		size_t m_entry_point;
+		// see get_filepath
+		std::string m_filepath;
+		// resolved commands (do this ahead of time so they don't have to be created from the byte code each time a command is run). they're
+		// in m_owned, unless the program runs them from a mapped file or a linked image in m_storage
+		std::vector<args> m_owned;
+		std::span<args> m_instructions;
+		std::shared_ptr<void> m_storage;
+		// see get_labels
+		std::vector<std::pair<size_t, std::string>> m_labels;
+		// copied to the vm's RAM when the script is assembled or deserialized, and kept for serialize
+		data_segment m_data;
+		// see get_symbols
+		symbol_table m_symbols;
+		// runs of every script running the program, until it's compiled to native code (see vm::set_jit_threshold). scripts on other threads
+		// (vm::run_batch) can get there at the same time, so the one that sets m_compiling compiles it into m_native and publishes it in m_jit,
+		// and the others carry on in the interpreter until then
+		std::atomic<size_t> m_run_count;
+		std::unique_ptr<jit_code> m_native;
+		std::atomic<jit_code*> m_jit;
+		std::atomic<bool> m_compiling;
+		// see get_stack_need
+		size_t m_stack_need;
+		// version of this program compiled ahead of time, if one was linked in
+		typename aot<STACK, RAM>::function m_aot;
+	};
+}
@@ -10,7 +10,8 @@ namespace hasl::sasm
 		i_t i[c::int_reg_count] = { 0 };
 		// indices 20-35
 		f_t f[c::float_reg_count] = { 0.f };
-		// indices 36-51
-		v_t v[c::vec_reg_count];
+		// indices 36-51. packed back to back and 16 byte aligned, so each pair of registers fills one SSE/NEON register
+		alignas(16) v_t v[c::vec_reg_count];
 	};
+	static_assert(sizeof(v_t) == 8 && alignof(v_t) == 8, "vector registers are expected to be two packed floats");
 }
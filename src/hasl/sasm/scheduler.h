@@ -0,0 +1,263 @@
+#pragma once
+#include "pch.h"
+#include "vm.h"
+
+namespace hasl::sasm
+{
+	// owns a set of scripts and runs them on a vm each tick, skipping the ones that are asleep. sleeping scripts are filed in a hierarchical
+	// timer wheel by the tick their slp ends on, so a tick only touches the scripts that are awake or just woke up, however many are asleep.
+	template<size_t STACK, size_t RAM>
+	class scheduler
+	{
+	public:
+		typedef size_t handle;
+	public:
+		// resolution is the length of one tick of the wheel, in the same units as script_runtime::current_time (and slp's operand). the default
+		// is a millisecond for a host that counts seconds: one that counts milliseconds (like tools/sasm_world) passes 1
+		scheduler(vm<STACK, RAM>* const vm, float resolution = .001f) :
+			m_vm(vm),
+			m_resolution(resolution),
+			m_tick(0),
+			m_filed(0)
+		{}
+		HASL_DCM(scheduler);
+	public:
+		// takes ownership of s. rt must outlive it here (its times are set by tick before every run). this and remove can be called during tick
+		// (from process_spawn_queue, say): a script added then first runs on the next tick
+		handle add(std::unique_ptr<script<STACK, RAM>> s, script_runtime* const rt)
+		{
+			handle h;
+			if (m_free.empty())
+			{
+				h = m_entries.size();
+				m_entries.emplace_back();
+			}
+			else
+			{
+				h = m_free.back();
+				m_free.pop_back();
+			}
+
+			entry& e = m_entries[h];
+			e.s = std::move(s);
+			e.rt = rt;
+			e.deadline = 0;
+			// a new script runs on the next tick, or once its sleep ends if it's already asleep
+			file(h);
+			return h;
+		}
+		// destroys the script
+		void remove(handle h)
+		{
+			entry& e = m_entries[h];
+			if (!e.s)
+				return;
+			// it's dropped lazily by whichever list or slot still refers to it
+			e.s.reset();
+			e.generation++;
+			m_free.push_back(h);
+		}
+		script<STACK, RAM>* get(handle h) const
+		{
+			return m_entries[h].s.get();
+		}
+		// runs every script that's awake at current_time, returns each one's handle and reg_flag (except for any removed while it ran).
+		// frame_budget caps the instructions they run together (0 is unlimited): the script that reaches it is preempted, and the ones that
+		// didn't get to run go first next tick
+		const std::vector<std::pair<handle, i_t>>& tick(float current_time, float delta_time, size_t frame_budget = 0)
+		{
+			m_results.clear();
+			advance(to_tick(current_time));
+
+			m_running.swap(m_deferred);
+			m_running.insert(m_running.end(), m_ready.begin(), m_ready.end());
+			m_running.insert(m_running.end(), m_due.begin(), m_due.end());
+			m_ready.clear();
+			m_due.clear();
+
+			size_t left = frame_budget;
+			for (const ref& r : m_running)
+			{
+				entry& e = m_entries[r.index];
+				if (!e.s || e.generation != r.generation)
+					continue;
+
+				// woken a little early (its deadline is the tick its sleep ends in), so it goes back in for the next one
+				const context<STACK>& ctx = e.s->get_context();
+				if (ctx.sleeping && current_time < ctx.sleep_end)
+				{
+					file(r.index);
+					continue;
+				}
+
+				if (frame_budget && left == 0)
+				{
+					m_deferred.push_back(r);
+					continue;
+				}
+				size_t budget = m_vm->m_instruction_budget;
+				if (frame_budget)
+					budget = budget ? std::min(budget, left) : left;
+
+				e.rt->current_time = current_time;
+				e.rt->delta_time = delta_time;
+				const i_t flag = m_vm->run(*e.s, *e.rt, budget);
+				// process_spawn_queue can add scripts, which can move the entries, or remove them, this one included
+				const entry& ran = m_entries[r.index];
+				if (!ran.s || ran.generation != r.generation)
+					continue;
+				m_results.emplace_back(r.index, flag);
+				left -= std::min(left, ran.s->get_context().executed);
+				file(r.index);
+			}
+			m_running.clear();
+			return m_results;
+		}
+	private:
+		// 4 levels of 256 slots covers 2^32 ticks (about 50 days at a resolution of a millisecond)
+		constexpr static size_t s_bits = 8, s_slots = 1 << s_bits, s_levels = 4, s_words = s_slots / 64;
+		constexpr static uint64_t s_mask = s_slots - 1;
+		constexpr static uint64_t s_range = HASL_CAST(uint64_t, 1) << (s_bits * s_levels);
+	private:
+		struct entry
+		{
+			std::unique_ptr<script<STACK, RAM>> s;
+			script_runtime* rt = nullptr;
+			// bumped when the entry is removed, so stale refs to it are ignored
+			size_t generation = 0;
+			uint64_t deadline = 0;
+		};
+		struct ref
+		{
+			size_t index, generation;
+		};
+	private:
+		vm<STACK, RAM>* const m_vm;
+		const float m_resolution;
+		std::vector<entry> m_entries;
+		std::vector<handle> m_free;
+		// awake (run every tick), woken up by the wheel this tick, and left over when the last tick ran out of budget
+		std::vector<ref> m_ready, m_due, m_deferred, m_running;
+		std::vector<ref> m_wheel[s_levels][s_slots];
+		// a bit for each slot in m_wheel that isn't empty, so advance can find the next one
+		uint64_t m_occupied[s_levels][s_words] = {};
+		// last tick the wheel was advanced to
+		uint64_t m_tick;
+		// number of refs in m_wheel (including stale ones)
+		size_t m_filed;
+		std::vector<std::pair<handle, i_t>> m_results;
+	private:
+		uint64_t to_tick(float time) const
+		{
+			return HASL_CAST(uint64_t, std::max(std::floor(HASL_CAST(double, time) / m_resolution), 0.));
+		}
+		// puts the entry in the ready list if it's awake, or in the wheel if it's asleep
+		void file(handle h)
+		{
+			entry& e = m_entries[h];
+			const context<STACK>& ctx = e.s->get_context();
+			const ref r = { h, e.generation };
+			if (!ctx.sleeping)
+			{
+				m_ready.push_back(r);
+				return;
+			}
+
+			// the tick the sleep ends in (and never one that's already gone)
+			e.deadline = std::max(to_tick(ctx.sleep_end), m_tick + 1);
+			insert(r, e.deadline);
+		}
+		void insert(const ref& r, uint64_t deadline)
+		{
+			// too far out for the wheel, so park it in the farthest slot and re-file it when that slot cascades
+			const uint64_t delta = std::min(deadline - m_tick, s_range - 1);
+			const uint64_t slot_tick = m_tick + delta;
+
+			size_t level = 0;
+			while (level < s_levels - 1 && delta >= (HASL_CAST(uint64_t, 1) << (s_bits * (level + 1))))
+				level++;
+			const size_t index = (slot_tick >> (s_bits * level)) & s_mask;
+			m_wheel[level][index].push_back(r);
+			m_occupied[level][index / 64] |= HASL_CAST(uint64_t, 1) << (index % 64);
+			m_filed++;
+		}
+		// moves the wheel forward to tick `to`, collecting the entries whose deadlines pass in m_due. it jumps from each tick that has something
+		// to do (a slot comes due, or one on a higher level cascades) to the next, so the empty ones in between cost nothing
+		void advance(uint64_t to)
+		{
+			while (m_filed > 0)
+			{
+				const uint64_t next = next_event();
+				if (next > to)
+					break;
+				m_tick = next;
+
+				// each level's slot is emptied into the levels below it when the ones below wrap around, highest first
+				size_t top = 0;
+				while (top < s_levels - 1 && (m_tick & ((HASL_CAST(uint64_t, 1) << (s_bits * (top + 1))) - 1)) == 0)
+					top++;
+				for (size_t level = top; level > 0; level--)
+					cascade(level, (m_tick >> (s_bits * level)) & s_mask);
+
+				const size_t index = m_tick & s_mask;
+				std::vector<ref>& slot = m_wheel[0][index];
+				m_occupied[0][index / 64] &= ~(HASL_CAST(uint64_t, 1) << (index % 64));
+				m_filed -= slot.size();
+				for (const ref& r : slot)
+				{
+					const entry& e = m_entries[r.index];
+					if (e.s && e.generation == r.generation)
+						m_due.push_back(r);
+				}
+				slot.clear();
+			}
+			m_tick = std::max(m_tick, to);
+		}
+		// the first tick after m_tick that empties an occupied slot: its own on level 0, or the one a higher level's slot cascades on (when the
+		// levels below it wrap around). UINT64_MAX if the wheel is empty
+		uint64_t next_event() const
+		{
+			uint64_t next = UINT64_MAX;
+			for (size_t level = 0; level < s_levels; level++)
+			{
+				const uint64_t position = m_tick >> (s_bits * level);
+				const size_t d = distance(level, position & s_mask);
+				if (d)
+					next = std::min(next, (position + d) << (s_bits * level));
+			}
+			return next;
+		}
+		// how many slots after from the next occupied one on level is (s_slots if it's from itself, a whole turn of the wheel away), or 0 if
+		// they're all empty
+		size_t distance(size_t level, size_t from) const
+		{
+			for (size_t d = 1; d <= s_slots;)
+			{
+				const size_t index = (from + d) & s_mask;
+				const uint64_t bits = m_occupied[level][index / 64] >> (index % 64);
+				if (bits)
+					return d + std::countr_zero(bits);
+				d += 64 - index % 64;
+			}
+			return 0;
+		}
+		void cascade(size_t level, size_t index)
+		{
+			std::vector<ref> slot;
+			slot.swap(m_wheel[level][index]);
+			m_occupied[level][index / 64] &= ~(HASL_CAST(uint64_t, 1) << (index % 64));
+			m_filed -= slot.size();
+			for (const ref& r : slot)
+			{
+				const entry& e = m_entries[r.index];
+				if (!e.s || e.generation != r.generation)
+					continue;
+				// due now (only possible for entries that were parked at the end of the range)
+				if (e.deadline <= m_tick)
+					m_due.push_back(r);
+				else
+					insert(r, e.deadline);
+			}
+		}
+	};
+}
@@ -1,57 +1,90 @@
 #pragma once
 #include "pch.h"
-#include "registers.h"
-#include "command.h"
-#include "assembler.h"
+#include "context.h"
+#include "program.h"
 
 namespace hasl::sasm
 {
-	template<size_t, size_t>
-	class vm;
-
+	// one running copy of a program: its registers, stack, program counter, and sleep state, kept between runs. the program is shared, so a
+	// script for each of many entities costs its context rather than another copy of the code (make them from another script's get_program)
 	template<size_t STACK, size_t RAM>
 	class script
 	{
-		friend class assembler<STACK, RAM>;
 		friend class vm<STACK, RAM>;
+		friend class jit<STACK, RAM>;
+		friend class aot<STACK, RAM>;
+		friend class lanes<STACK, RAM>;
+		friend class profiler<STACK, RAM>;
+		friend class script_cache<STACK, RAM>;
+		friend class linker<STACK, RAM>;
+	public:
+		// the vm's sizes, so templates that take a script type (deserialize, archive::load) don't have to deduce them from a vm pointer,
+		// which may be nullptr
+		constexpr static size_t s_stack = STACK, s_ram = RAM;
 	public:
+		// each of these makes a program of its own, from the same arguments as program's constructors
 		script(const char* fp, vm<STACK, RAM>* const vm) :
-			m_assembled(false),
-			m_abort(false),
-			m_sleeping(false),
-			m_entry_point(0),
-			m_sleep_end(0),
-			m_filepath(fp),
-			m_vm(vm)
-		{
-			m_assembled = assembler<STACK, RAM>(fp, this, vm).assemble();
-		}
-		script(uint64_t entry_point, const std::vector<uint64_t>& byte_code, const std::vector<args>& instructions) :
-			m_assembled(true),
-			m_abort(false),
-			m_entry_point(entry_point),
-			m_sleep_end(0),
-			m_filepath(""),
-			m_byte_code(byte_code),
-			m_instructions(instructions),
-			m_vm(nullptr)
+			script(std::make_shared<program<STACK, RAM>>(fp, vm))
+		{}
+		script(uint64_t entry_point, const std::vector<args>& instructions, const std::vector<std::pair<size_t, std::string>>& labels = {},
+			const data_segment& data = {}, const symbol_table& symbols = {}, const char* name = "") :
+			script(std::make_shared<program<STACK, RAM>>(entry_point, instructions, labels, data, symbols, name))
+		{}
+		script(uint64_t entry_point, std::span<args> instructions, size_t stack_need, const std::vector<std::pair<size_t, std::string>>& labels,
+			const data_segment& data, const symbol_table& symbols, std::shared_ptr<void> storage, const char* name = "") :
+			script(std::make_shared<program<STACK, RAM>>(entry_point, instructions, stack_need, labels, data, symbols, std::move(storage), name))
+		{}
+		// runs p, which it keeps alive
+		explicit script(std::shared_ptr<program<STACK, RAM>> p) :
+			m_program(std::move(p)),
+			m_instructions(m_program->m_instructions)
 		{}
 		HASL_DCM(script);
 	public:
-		void serialize(std::ofstream& out)
+		const std::shared_ptr<program<STACK, RAM>>& get_program() const
+		{
+			return m_program;
+		}
+		bool is_assembled() const
+		{
+			return m_program->is_assembled();
+		}
+		size_t get_entry_point() const
+		{
+			return m_program->get_entry_point();
+		}
+		std::span<const args> get_instructions() const
+		{
+			return m_instructions;
+		}
+		const context<STACK>& get_context() const
+		{
+			return m_context;
+		}
+		size_t get_stack_need() const
+		{
+			return m_program->get_stack_need();
+		}
+		const std::vector<std::pair<size_t, std::string>>& get_labels() const
+		{
+			return m_program->get_labels();
+		}
+		const data_segment& get_data() const
+		{
+			return m_program->get_data();
+		}
+		const symbol_table& get_symbols() const
+		{
+			return m_program->get_symbols();
+		}
+		void serialize(std::ostream& out) const
 		{
-			write_ulong(out, m_entry_point);
-			for (const auto& i : m_byte_code)
-				write_ulong(out, i);
+			m_program->serialize(out);
 		}
 	private:
-		bool m_assembled, m_abort, m_sleeping;
-		size_t m_entry_point;
-		float m_sleep_end;
-		std::string m_filepath;
-		std::vector<uint64_t> m_byte_code;
-		// resolved commands (do this ahead of time so they don't have to be created from the byte code each time a command is run).
-		std::vector<args> m_instructions;
-		vm<STACK, RAM>* m_vm;
+		std::shared_ptr<program<STACK, RAM>> m_program;
+		// the program's, kept here too since every branch checks its size
+		std::span<args> m_instructions;
+		context<STACK> m_context;
 	};
 }
@@ -0,0 +1,231 @@
+#pragma once
+#include "pch.h"
+#include "bytecode.h"
+#include "deserialize.h"
+
+namespace hasl::sasm
+{
+	// a directory of assembled scripts, each filed under a hash of its source text and of this build's instruction set (see
+	// vm::handler_fingerprint), so loading a script whose source hasn't changed deserializes it instead of assembling it again. when the
+	// files add up to more than max_bytes, the ones used least recently are deleted. it isn't safe to use from several threads at once
+	template<size_t STACK, size_t RAM>
+	class script_cache
+	{
+	public:
+		struct statistics
+		{
+			uint64_t hits = 0, misses = 0, evictions = 0;
+			// time spent assembling on misses, and the time hits would have spent assembling minus what loading them took
+			double assemble_seconds = 0, saved_seconds = 0;
+
+			double hit_rate() const
+			{
+				return hits + misses ? HASL_CAST(double, hits) / (hits + misses) : 0;
+			}
+		};
+	public:
+		script_cache(const char* const directory, size_t max_bytes = 64 << 20) :
+			m_directory(directory),
+			m_max_bytes(max_bytes),
+			m_bytes(0)
+		{
+			std::error_code error;
+			std::filesystem::create_directories(m_directory, error);
+			for (const auto& entry : std::filesystem::directory_iterator(m_directory, error))
+			{
+				if (!entry.is_regular_file() || entry.path().extension() != s_extension)
+					continue;
+				m_files.push_back({ entry.path(), entry.file_size(), entry.last_write_time() });
+				m_bytes += m_files.back().size;
+			}
+			evict();
+		}
+		HASL_DCM(script_cache);
+	public:
+		// the script at fp (new, like script(fp, vm)), from the cache if its source is in it. returns nullptr if the file can't be read
+		template<typename T = script<STACK, RAM>>
+		T* load(const char* const fp, vm<STACK, RAM>* const vm)
+		{
+			const auto start = std::chrono::steady_clock::now();
+			std::ifstream in(fp, std::ios::binary);
+			if (!in.is_open())
+			{
+				printf("Error opening script file '%s'\n", fp);
+				return nullptr;
+			}
+			const std::string source((std::istreambuf_iterator<char>(in)), std::istreambuf_iterator<char>());
+			const uint64_t key = hash(source);
+			const std::filesystem::path path = m_directory / (to_hex(key) + s_extension);
+
+			double assembled = 0;
+			if (T* const s = find<T>(path, key, source.size(), fp, vm, &assembled))
+			{
+				m_stats.hits++;
+				m_stats.saved_seconds += assembled - seconds_since(start);
+				return s;
+			}
+
+			m_stats.misses++;
+			T* const s = new T(fp, vm);
+			const double seconds = seconds_since(start);
+			m_stats.assemble_seconds += seconds;
+			if (s->is_assembled())
+				store(path, key, source.size(), seconds, *s);
+			return s;
+		}
+		const statistics& get_stats() const
+		{
+			return m_stats;
+		}
+		void reset_stats()
+		{
+			m_stats = {};
+		}
+		// bytes of the cache's files
+		size_t size() const
+		{
+			return m_bytes;
+		}
+		// deletes every file in the cache
+		void clear()
+		{
+			for (const file& f : m_files)
+				remove(f.path);
+			m_files.clear();
+			m_bytes = 0;
+		}
+	private:
+		// start of a cache file, followed by the serialized script at s_offset
+		struct header
+		{
+			char magic[4];
+			uint32_t version;
+			uint64_t key, source_size;
+			// how long the script took to assemble, which a hit saves
+			uint64_t assemble_ns;
+		};
+		struct file
+		{
+			std::filesystem::path path;
+			size_t size;
+			std::filesystem::file_time_type used;
+		};
+		constexpr static char s_magic[4] = { 'S', 'A', 'S', 'C' };
+		// the serialized script starts on a cache line, which keeps its instructions aligned
+		constexpr static size_t s_offset = 64;
+		constexpr static const char* s_extension = ".sbc";
+		static_assert(sizeof(header) <= s_offset);
+	private:
+		std::filesystem::path m_directory;
+		size_t m_max_bytes, m_bytes;
+		std::vector<file> m_files;
+		statistics m_stats;
+	private:
+		// FNV-1a of the source, the instruction set, and the format it's cached in
+		static uint64_t hash(const std::string& source)
+		{
+			uint64_t h = fnv1a_basis;
+			for (const uint64_t word : { vm<STACK, RAM>::handler_fingerprint(), HASL_CAST(uint64_t, bytecode_header::s_version),
+				HASL_CAST(uint64_t, STACK), HASL_CAST(uint64_t, RAM) })
+				h = fnv1a(word, h);
+			return fnv1a(source.data(), source.size(), h);
+		}
+		static std::string to_hex(uint64_t key)
+		{
+			char name[17];
+			snprintf(name, sizeof(name), "%016llx", HASL_CAST(unsigned long long, key));
+			return name;
+		}
+		static double seconds_since(std::chrono::steady_clock::time_point start)
+		{
+			return std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+		}
+		// the script cached at path, if there is one for this key and source size, or nullptr. assembled is set to how long it took to assemble
+		template<typename T>
+		T* find(const std::filesystem::path& path, uint64_t key, size_t source_size, const char* const fp, vm<STACK, RAM>* const vm,
+			double* const assembled)
+		{
+			const auto it = std::find_if(m_files.begin(), m_files.end(), [&](const file& f) { return f.path == path; });
+			if (it == m_files.end())
+				return nullptr;
+
+			const auto mapping = std::make_shared<mapped_file>(path.string().c_str());
+			header h;
+			if (!mapping->data() || mapping->size() <= s_offset)
+				return nullptr;
+			memcpy(&h, mapping->data(), sizeof(h));
+			if (memcmp(h.magic, s_magic, sizeof(h.magic)) != 0 || h.version != bytecode_header::s_version || h.key != key ||
+				h.source_size != source_size)
+				return nullptr;
+
+			// named for its source, so it reads the same as one that was assembled
+			T* const s = deserialize<T>(mapping, s_offset, mapping->size() - s_offset, vm, path.string().c_str(), fp);
+			if (!s)
+				return nullptr;
+			*assembled = h.assemble_ns / 1e9;
+
+			std::error_code error;
+			it->used = std::filesystem::file_time_type::clock::now();
+			std::filesystem::last_write_time(path, it->used, error);
+			return s;
+		}
+		void store(const std::filesystem::path& path, uint64_t key, size_t source_size, double seconds, const script<STACK, RAM>& s)
+		{
+			header h = {};
+			memcpy(h.magic, s_magic, sizeof(h.magic));
+			h.version = bytecode_header::s_version;
+			h.key = key;
+			h.source_size = source_size;
+			h.assemble_ns = HASL_CAST(uint64_t, seconds * 1e9);
+
+			// written next to it and renamed, so a file that's there is always whole
+			std::filesystem::path temporary = path;
+			temporary += ".tmp";
+			{
+				std::ofstream out(temporary, std::ios::binary);
+				if (!out.is_open())
+					return;
+				out.write(reinterpret_cast<const char*>(&h), sizeof(h));
+				out << std::string(s_offset - sizeof(h), '\0');
+				s.serialize(out);
+				if (!out.good())
+					return;
+			}
+			std::error_code error;
+			std::filesystem::rename(temporary, path, error);
+			if (error)
+				return;
+
+			const size_t size = std::filesystem::file_size(path, error);
+			const auto it = std::find_if(m_files.begin(), m_files.end(), [&](const file& f) { return f.path == path; });
+			if (it != m_files.end())
+			{
+				m_bytes -= it->size;
+				m_files.erase(it);
+			}
+			m_files.push_back({ path, size, std::filesystem::file_time_type::clock::now() });
+			m_bytes += size;
+			evict();
+		}
+		// deletes the least recently used files until the rest fit in max_bytes
+		void evict()
+		{
+			if (m_bytes <= m_max_bytes)
+				return;
+			std::sort(m_files.begin(), m_files.end(), [](const file& a, const file& b) { return a.used > b.used; });
+			while (m_bytes > m_max_bytes && !m_files.empty())
+			{
+				remove(m_files.back().path);
+				m_bytes -= m_files.back().size;
+				m_files.pop_back();
+				m_stats.evictions++;
+			}
+		}
+		static void remove(const std::filesystem::path& path)
+		{
+			// a script still running from the file keeps its pages (unless the system won't delete a mapped file, in which case it stays)
+			std::error_code error;
+			std::filesystem::remove(path, error);
+		}
+	};
+}
@@ -50,12 +50,12 @@ namespace hasl::sasm
 		template<typename T>
 		const T* const get_state() const
 		{
-			return HASL_CAST(T*, m_states[m_state]);
+			return HASL_CAST(T*, m_states.at(m_state));
 		}
 		template<typename T>
 		T* const get_state()
 		{
-			return HASL_CAST(T*, m_states[m_state]);
+			return HASL_CAST(T*, m_states.at(m_state));
 		}
 	private:
 		std::unordered_map<std::string, void*> m_states;
@@ -0,0 +1,174 @@
+#pragma once
+#include "pch.h"
+
+namespace hasl::sasm
+{
+	// records what scripts do on a timeline while it's set with vm::set_tracer: each run, the engine hooks their instructions call,
+	// process_spawn_queue, and the time a script spends asleep after slp. each thread writes to its own ring buffer without locking, which keeps
+	// the latest `capacity` events, and write saves them as a Chrome trace (for chrome://tracing or ui.perfetto.dev)
+	class tracer
+	{
+	public:
+		enum class phase : char
+		{
+			BEGIN = 'B',
+			END = 'E',
+			// a slice that can end on another thread (a script's sleep), matched up by id
+			ASYNC_BEGIN = 'b',
+			ASYNC_END = 'e'
+		};
+		// records a slice from construction to destruction, if t isn't null
+		class span
+		{
+		public:
+			span(tracer* const t, const char* category, const char* name) :
+				m_tracer(t),
+				m_category(category),
+				m_name(name)
+			{
+				if (m_tracer)
+					m_tracer->record(phase::BEGIN, m_category, m_name);
+			}
+			~span()
+			{
+				if (m_tracer)
+					m_tracer->record(phase::END, m_category, m_name);
+			}
+			HASL_DCM(span);
+		private:
+			tracer* const m_tracer;
+			const char* m_category;
+			const char* m_name;
+		};
+	public:
+		tracer(size_t capacity = 1 << 16) :
+			m_capacity(capacity ? capacity : 1),
+			m_serial(++s_serial),
+			m_start(std::chrono::steady_clock::now())
+		{}
+		HASL_DCM(tracer);
+	public:
+		// category has to outlive the tracer (a literal), name is copied (just the end of it, if it's long)
+		void record(phase ph, const char* category, const char* name, uint64_t id = 0)
+		{
+			ring& r = local();
+			const uint64_t head = r.head.load(std::memory_order_relaxed);
+			event& e = r.events[head % m_capacity];
+			e.ns = HASL_CAST(uint64_t, std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now() - m_start).count());
+			e.id = id;
+			e.category = category;
+			e.ph = ph;
+			const size_t length = strlen(name);
+			const size_t kept = std::min(length, sizeof(e.name) - 1);
+			memcpy(e.name, name + length - kept, kept);
+			e.name[kept] = 0;
+			r.head.store(head + 1, std::memory_order_release);
+		}
+		// writes every thread's events as Chrome trace JSON, returns false if fp couldn't be opened. the buffers are read as they are, so this
+		// should be called while nothing is being recorded
+		bool write(const char* const fp) const
+		{
+			std::ofstream out(fp);
+			if (!out.is_open())
+			{
+				printf("Error opening trace output file '%s'\n", fp);
+				return false;
+			}
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			out << "{\"displayTimeUnit\":\"ns\",\"traceEvents\":[";
+			bool first = true;
+			char line[256];
+			for (const std::unique_ptr<ring>& r : m_rings)
+			{
+				snprintf(line, sizeof(line), "%s\n{\"ph\":\"M\",\"name\":\"thread_name\",\"pid\":1,\"tid\":%zu,\"args\":{\"name\":\"sasm %zu\"}}",
+					first ? "" : ",", r->index, r->index);
+				out << line;
+				first = false;
+
+				const uint64_t head = r->head.load(std::memory_order_acquire);
+				const uint64_t count = std::min(head, HASL_CAST(uint64_t, m_capacity));
+				for (uint64_t i = head - count; i < head; i++)
+				{
+					const event& e = r->events[i % m_capacity];
+					snprintf(line, sizeof(line), ",\n{\"ph\":\"%c\",\"cat\":\"%s\",\"name\":\"%s\",\"pid\":1,\"tid\":%zu,\"ts\":%.3f",
+						HASL_CAST(char, e.ph), e.category, escape(e.name).c_str(), r->index, e.ns / 1000.);
+					out << line;
+					if (e.ph == phase::ASYNC_BEGIN || e.ph == phase::ASYNC_END)
+					{
+						snprintf(line, sizeof(line), ",\"id\":\"0x%llx\"", HASL_CAST(unsigned long long, e.id));
+						out << line;
+					}
+					out << "}";
+				}
+			}
+			out << "\n]}\n";
+			return true;
+		}
+	private:
+		// one cache line
+		struct event
+		{
+			uint64_t ns, id;
+			const char* category;
+			char name[39];
+			phase ph;
+		};
+		// the events of one thread, which is the only one that writes to it
+		struct ring
+		{
+			std::thread::id thread;
+			size_t index;
+			std::atomic<uint64_t> head;
+			std::vector<event> events;
+		};
+	private:
+		const size_t m_capacity;
+		// tells tracers apart, for the ring each thread remembers (one may be made where another was destroyed)
+		const uint64_t m_serial;
+		const std::chrono::steady_clock::time_point m_start;
+		mutable std::mutex m_mutex;
+		std::vector<std::unique_ptr<ring>> m_rings;
+		static inline std::atomic<uint64_t> s_serial = 0;
+	private:
+		// the calling thread's ring, found once per thread (unless it switches between tracers)
+		ring& local()
+		{
+			thread_local uint64_t t_serial = 0;
+			thread_local ring* t_ring = nullptr;
+			if (t_serial == m_serial)
+				return *t_ring;
+
+			std::lock_guard<std::mutex> lock(m_mutex);
+			const std::thread::id id = std::this_thread::get_id();
+			t_ring = nullptr;
+			for (const std::unique_ptr<ring>& r : m_rings)
+				if (r->thread == id)
+					t_ring = r.get();
+			if (!t_ring)
+			{
+				m_rings.push_back(std::make_unique<ring>());
+				t_ring = m_rings.back().get();
+				t_ring->thread = id;
+				t_ring->index = m_rings.size() - 1;
+				t_ring->head = 0;
+				t_ring->events.resize(m_capacity);
+			}
+			t_serial = m_serial;
+			return *t_ring;
+		}
+		// for a JSON string (script paths can have backslashes in them)
+		static std::string escape(const char* s)
+		{
+			std::string escaped;
+			for (; *s; s++)
+			{
+				if (*s == '"' || *s == '\\')
+					escaped += '\\';
+				if (HASL_CAST(unsigned char, *s) >= ' ')
+					escaped += *s;
+			}
+			return escaped;
+		}
+	};
+}
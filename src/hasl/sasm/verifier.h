@@ -0,0 +1,254 @@
+#pragma once
+#include "pch.h"
+#include "vm.h"
+
+namespace hasl::sasm
+{
+	// runs once when a script is loaded, and switches the instructions whose checks it can prove never fail to handlers without them
+	// (see HASL_SASM_UNCHECKED_HANDLERS):
+	// - branches, j and call to a label in range
+	// - stm and ldm with an immediate address in range
+	// - psh, pop, call and ret if the stack is structured: every subroutine returns with the stack the way it found it and nothing pops what
+	//   its caller pushed (so nothing can underflow), and there's no recursion or loop that keeps pushing (so the most one run can push is
+	//   known, and vm::prepare makes sure there's room for it before a run starts)
+	// addresses in registers keep their checks, and so does everything if the stack isn't structured
+	template<size_t STACK, size_t RAM>
+	class verifier
+	{
+	public:
+		// stack use that couldn't be bounded
+		constexpr static size_t s_unbounded = ~HASL_CAST(size_t, 0);
+	public:
+		// returns the most stack slots one run of p can use, or s_unbounded
+		static size_t verify(program<STACK, RAM>& p)
+		{
+			return verify(p.m_instructions, { p.m_entry_point }).front();
+		}
+		// the same for code that's run from several entry points (the scripts in an image made by linker), returning what a run from each
+		// can use. they share the code, so its stack checks only come out if every one of them is bounded
+		static std::vector<size_t> verify(std::span<args> code, const std::vector<size_t>& entries)
+		{
+			const size_t count = code.size();
+
+			std::vector<routine> routines;
+			std::unordered_map<size_t, size_t> found;
+			for (const size_t entry : entries)
+				if (found.emplace(entry, routines.size()).second)
+					routines.emplace_back(entry);
+			const size_t roots = routines.size();
+			bool structured = true;
+			for (size_t i = 0; i < routines.size() && structured; i++)
+			{
+				structured = walk(code, i < roots, &routines[i]);
+				// copied, since adding routines can move this one
+				const std::vector<call> calls = routines[i].calls;
+				for (const call& c : calls)
+					if (found.emplace(c.target, routines.size()).second)
+						routines.emplace_back(c.target);
+			}
+			std::vector<size_t> needs;
+			bool bounded = structured && !entries.empty();
+			for (const size_t entry : entries)
+			{
+				needs.push_back(structured ? deepest(routines, found, found.at(entry)) : s_unbounded);
+				bounded = bounded && needs.back() <= STACK;
+			}
+
+			for (args& a : code)
+			{
+				const uint16_t form = machine::quicken(a);
+				// superinstructions keep their checked parts
+				if (a.handler != form)
+					continue;
+
+				bool proven = false;
+				switch (HASL_CAST(op, form))
+				{
+				case op::beq_i: case op::beq_f: case op::beq_v: case op::beqz_i: case op::beqz_f: case op::beqz_v:
+				case op::bne_i: case op::bne_f: case op::bne_v: case op::blt_i: case op::blt_f: case op::bgt_i: case op::bgt_f:
+				case op::ble_i: case op::ble_f: case op::bge_i: case op::bge_f: case op::j:
+					proven = in_range(a, count);
+					break;
+				case op::call:
+					proven = in_range(a, count) && bounded;
+					break;
+				case op::psh_i: case op::psh_f: case op::psh_v:
+					proven = bounded;
+					break;
+				case op::pop_i: case op::pop_f: case op::pop_v: case op::ret:
+					proven = structured;
+					break;
+				case op::stm_i: case op::stm_f: case op::stm_v:
+					proven = a.type(1) == reg_type::NONE && addressable(a.ii);
+					break;
+				case op::ldm:
+					proven = a.type(0) == reg_type::NONE && addressable(a.ii);
+					break;
+				default:
+					break;
+				}
+				if (proven)
+					a.handler = unchecked(form);
+			}
+			if (!bounded)
+				std::fill(needs.begin(), needs.end(), s_unbounded);
+			return needs;
+		}
+	private:
+		typedef vm<STACK, RAM> machine;
+		typedef typename machine::op op;
+		// a call to target, made with the routine's stack at depth
+		struct call
+		{
+			size_t target, depth;
+		};
+		// the code reachable from the entry point, or from a call's target, without following calls
+		struct routine
+		{
+			explicit routine(size_t e) :
+				entry(e)
+			{}
+
+			size_t entry;
+			// deepest the stack gets above where it was at entry (not counting the return address)
+			size_t depth = 0;
+			std::vector<call> calls;
+			// 0 unvisited, 1 on the path deepest is following (so it's recursive), 2 done
+			uint8_t state = 0;
+			size_t need = 0;
+		};
+		// lowest and highest the stack can be at an instruction, relative to its routine's entry
+		struct range
+		{
+			size_t lo, hi;
+			bool seen = false;
+		};
+	private:
+		static bool in_range(const args& a, size_t count)
+		{
+			return a.ii >= 0 && HASL_CAST(size_t, a.ii) < count;
+		}
+		// room for an 8 byte access
+		static bool addressable(i_t address)
+		{
+			return address >= 0 && HASL_CAST(size_t, address) + sizeof(i_t) <= RAM;
+		}
+		static uint16_t unchecked(uint16_t form)
+		{
+#define X(name) case op::name: return HASL_CAST(uint16_t, op::name##_u);
+			switch (HASL_CAST(op, form))
+			{
+				HASL_SASM_UNCHECKED_HANDLERS(X)
+			default:
+				return form;
+			}
+#undef X
+		}
+		// follows every path through r's code, recording its calls and how deep its stack gets. returns false if it isn't structured (it can
+		// pop below its entry, or return from anywhere but its entry depth)
+		static bool walk(std::span<const args> code, bool top, routine* const r)
+		{
+			const size_t count = code.size();
+			// past STACK is as deep as it's tracked, so every loop settles
+			const size_t cap = STACK + 1;
+			std::vector<range> at(count);
+			std::vector<size_t> work;
+			auto reach = [&](size_t pc, size_t lo, size_t hi)
+			{
+				// falling off the end stops the script
+				if (pc >= count)
+					return;
+				range& d = at[pc];
+				hi = std::min(hi, cap);
+				if (d.seen && lo >= d.lo && hi <= d.hi)
+					return;
+				d.lo = d.seen ? std::min(d.lo, lo) : lo;
+				d.hi = d.seen ? std::max(d.hi, hi) : hi;
+				d.seen = true;
+				work.push_back(pc);
+			};
+
+			reach(r->entry, 0, 0);
+			while (!work.empty())
+			{
+				const size_t pc = work.back();
+				work.pop_back();
+				const args& a = code[pc];
+				const range d = at[pc];
+				r->depth = std::max(r->depth, d.hi);
+
+				// a branch to a label out of range stops the script
+				const bool jumps = in_range(a, count);
+				const size_t target = jumps ? HASL_CAST(size_t, a.ii) : 0;
+				switch (HASL_CAST(op, a.opcode))
+				{
+				case op::psh:
+					reach(pc + 1, d.lo + 1, d.hi + 1);
+					break;
+				case op::pop:
+					if (d.lo == 0)
+						return false;
+					reach(pc + 1, d.lo - 1, d.hi - 1);
+					break;
+				case op::call:
+					// the callee leaves the stack the way it found it, which is checked when it's walked
+					if (jumps)
+					{
+						r->calls.push_back({ target, d.hi });
+						reach(pc + 1, d.lo, d.hi);
+					}
+					break;
+				case op::ret:
+					// the entry point has nowhere to return to
+					if (top || d.lo != 0 || d.hi != 0)
+						return false;
+					break;
+				case op::end:
+					break;
+				case op::j:
+					if (jumps)
+						reach(target, d.lo, d.hi);
+					break;
+				case op::beq: case op::beqz: case op::bne: case op::blt: case op::bgt: case op::ble: case op::bge:
+					if (jumps)
+					{
+						reach(target, d.lo, d.hi);
+						reach(pc + 1, d.lo, d.hi);
+					}
+					break;
+				default:
+					// including slp, which carries on from the next instruction
+					reach(pc + 1, d.lo, d.hi);
+					break;
+				}
+			}
+			return true;
+		}
+		// the most stack routine i and the ones it calls can use, or s_unbounded if they recurse
+		static size_t deepest(std::vector<routine>& routines, const std::unordered_map<size_t, size_t>& found, size_t i)
+		{
+			routine& r = routines[i];
+			if (r.state == 1)
+				return s_unbounded;
+			if (r.state == 2)
+				return r.need;
+
+			r.state = 1;
+			size_t need = r.depth;
+			for (const call& c : r.calls)
+			{
+				const size_t callee = deepest(routines, found, found.at(c.target));
+				if (callee == s_unbounded)
+				{
+					need = s_unbounded;
+					break;
+				}
+				// the return address, then whatever the callee needs
+				need = std::max(need, c.depth + 1 + callee);
+			}
+			r.state = 2;
+			r.need = need;
+			return need;
+		}
+	};
+}
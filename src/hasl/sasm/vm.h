@@ -3,9 +3,61 @@
 #include "script.h"
 #include "script_runtime.h"
 #include "scriptable.h"
+#include "executor.h"
+#include "tracer.h"
+
+// every vm handler, in opcode order (must match vm::s_instructions)
+#define HASL_SASM_HANDLERS(X) \
+	X(add) X(addf) X(addv) X(sub) X(subf) X(subv) X(mul) X(mulf) X(mulv) X(div) X(divf) X(divv) \
+	X(band) X(bxor) X(bor) X(bnot) X(sl) X(sr) \
+	X(sine) X(cosine) X(tangent) X(arcsine) X(arccosine) X(arctangent) \
+	X(min) X(max) X(minf) X(maxf) X(minv) X(maxv) X(power) X(squareroot) X(absolute) X(absolutef) X(absolutev) X(random) X(randomf) X(sign) X(signf) X(signv) \
+	X(dot) X(mag) X(ang) X(angv) X(norm) \
+	X(psh) X(pop) X(mov) X(movl) X(movh) X(movf) X(movv) X(movx) X(movy) X(stm) X(ldm) \
+	X(beq) X(beqz) X(bne) X(blt) X(bgt) X(ble) X(bge) X(j) X(call) X(ret) X(end) X(slp) X(blk) \
+	X(dbg) X(dbgf) X(dbgv) X(dbgs) \
+	X(gettime) \
+	X(imp) X(ims) X(imb) X(ikp) X(ikd) \
+	X(ogp) X(osp) X(ogv) X(osv) X(ogd) X(ogs) X(oss) X(spn)
+// handlers specialized for one operand form, chosen by vm::quicken when an instruction is loaded
+#define HASL_SASM_QUICK_HANDLERS(X) \
+	X(add_r) X(add_i) X(sub_r) X(sub_i) X(mul_r) X(mul_i) X(div_r) X(div_i) \
+	X(band_r) X(band_i) X(bxor_r) X(bxor_i) X(bor_r) X(bor_i) X(sl_r) X(sl_i) X(sr_r) X(sr_i) X(min_r) X(min_i) X(max_r) X(max_i) \
+	X(bnot_r) X(bnot_i) X(absolute_r) X(absolute_i) X(sign_r) X(sign_i) \
+	X(addf_r) X(addf_i) X(subf_r) X(subf_i) X(mulf_r) X(mulf_i) X(divf_r) X(divf_i) X(minf_r) X(minf_i) X(maxf_r) X(maxf_i) X(power_r) X(power_i) \
+	X(squareroot_r) X(squareroot_i) X(absolutef_r) X(absolutef_i) X(signf_r) X(signf_i) \
+	X(addv_v) X(addv_f) X(addv_i) X(subv_v) X(subv_f) X(subv_i) X(mulv_v) X(mulv_f) X(mulv_i) X(divv_v) X(divv_f) X(divv_i) \
+	X(psh_i) X(psh_f) X(psh_v) X(pop_i) X(pop_f) X(pop_v) \
+	X(mov_i) X(mov_f) X(mov_m) X(movf_i) X(movf_f) X(movf_m) X(movv_v) X(movv_i) X(movv_f) X(movv_m) \
+	X(stm_i) X(stm_f) X(stm_v) \
+	X(beq_i) X(beq_f) X(beq_v) X(beqz_i) X(beqz_f) X(beqz_v) X(bne_i) X(bne_f) X(bne_v) \
+	X(blt_i) X(blt_f) X(bgt_i) X(bgt_f) X(ble_i) X(ble_f) X(bge_i) X(bge_f)
+// superinstructions, formed by vm::fuse from common sequences of quickened handlers
+#define HASL_SASM_FUSED_HANDLERS(X) \
+	X(add_i_blt_i) X(add_i_bne_i) X(sub_i_bgt_i) \
+	X(mov_m_add_r) X(mov_i_add_r) X(mov_i_sub_r) X(movf_m_mulf_r) X(movf_f_addf_r) X(movf_f_mulf_r) \
+	X(ogp_addv_v_osp) X(ogv_mulv_f) X(ogp_subv_v) \
+	X(psh_i_psh_i) X(psh_i_call) X(psh_f_call) X(psh_v_call) X(pop_i_pop_i)
+// handlers that have a form without their range, stack, or label checks (name##_u), chosen by verifier::verify when it can prove the
+// checks never fail
+#define HASL_SASM_UNCHECKED_HANDLERS(X) \
+	X(beq_i) X(beq_f) X(beq_v) X(beqz_i) X(beqz_f) X(beqz_v) X(bne_i) X(bne_f) X(bne_v) \
+	X(blt_i) X(blt_f) X(bgt_i) X(bgt_f) X(ble_i) X(ble_f) X(bge_i) X(bge_f) X(j) X(call) X(ret) \
+	X(psh_i) X(psh_f) X(psh_v) X(pop_i) X(pop_f) X(pop_v) X(stm_i) X(stm_f) X(stm_v) X(ldm)
 
 namespace hasl::sasm
 {
+	template<size_t, size_t>
+	class scheduler;
+	template<size_t, size_t>
+	class lanes;
+	template<size_t, size_t>
+	class verifier;
+	template<size_t, size_t>
+	class profiler;
+	template<size_t, size_t>
+	class linker;
+
 	struct mem_dump_options
 	{
 		bool ri = true, rf = true, rv = true;
@@ -18,43 +70,48 @@ namespace hasl::sasm
 	{
 		friend class assembler<STACK, RAM>;
 		friend class serializer;
+		friend class jit<STACK, RAM>;
+		friend class aot<STACK, RAM>;
+		friend class scheduler<STACK, RAM>;
+		friend class lanes<STACK, RAM>;
+		friend class verifier<STACK, RAM>;
+		friend class profiler<STACK, RAM>;
+		friend class linker<STACK, RAM>;
 	public:
 		vm() :
-			m_stack{ 0 },
 			m_memory{ 0 },
-			m_pc(0),
-			m_sp(0)
+			m_jit_threshold(0),
+			m_instruction_budget(0),
+			m_profiler(nullptr),
+			m_tracer(nullptr)
 		{
-			// static structures haven't been initialized yet
-			if (s_command_names.empty())
-			{
-				for (size_t i = 0; i < s_instructions.size(); i++)
-				{
-					const instruction& cur = s_instructions[i];
-					s_command_names.emplace(i, cur.name);
-					s_command_descriptions.emplace(cur.name, command_description(HASL_CAST(uint8_t, i), cur.desc));
-					s_operations[i] = cur.op;
-				}
-			}
+			initialize();
 		}
 		HASL_DCM(vm);
 	public:
-		void mem_dump(const mem_dump_options& options = {}) const
+		// registers and stack are those of s (if given)
+		void mem_dump(const mem_dump_options& options = {}, const script<STACK, RAM>* const s = nullptr) const
 		{
 			printf("\n\n====================\n= HASL VM MEM DUMP =\n====================\n\n");
 
+			if(options.ram)
+				arrprint(m_memory, "%u", ", ", 16);
+			if (!s)
+				return;
+			const context<STACK>* const ctx = &s->m_context;
+
 			if(options.ri)
-				arrprint(m_regs.i, "%lld", ", ", 8);
+				arrprint(ctx->regs.i, "%lld", ", ", 8);
 
 			if(options.rf)
-				arrprint(m_regs.f, "%f", ", ", 8);
+				arrprint(ctx->regs.f, "%f", ", ", 8);
 
 			if (options.rv)
 			{
 				printf("[\n\t");
 				for (size_t i = 0; i < c::vec_reg_count; i++)
 				{
-					printf("<%f, %f>", m_regs.v[i].x, m_regs.v[i].y);
+					printf("<%f, %f>", ctx->regs.v[i].x, ctx->regs.v[i].y);
 					if (i != c::vec_reg_count - 1)
 						printf(", ");
 					if ((i + 1) % 4 == 0)
@@ -68,45 +125,207 @@ namespace hasl::sasm
 			}
 			
 			if(options.stack)
-				arrprint(m_stack, "%llu", ", ", 16);
-			if(options.ram)
-				arrprint(m_memory, "%u", ", ", 16);
+				arrprint(ctx->stack, "%llu", ", ", 16);
 		}
-		args deserialize(uint64_t i)
-		{
-			args a = deserialize_base(i);
-
-			printf("%llx\n", i);
-			printf("%u | %llx | %llx\n", a.opcode, (i & 0xff000000000000) >> 48, (i & 0xff0000000000) >> 40);
-			deserialize_reg(a, (i & 0xff000000000000) >> 48, 0);
-			deserialize_reg(a, (i & 0xff0000000000) >> 40, 2);
-
-			uint64_t flags = (i & 0xff00000000) >> 32, reg = i & 0xff, imm = i & 0xffffffff;
-			if (flags == 1)
-				a.i[1] = get_int_reg(reg);
-			else if (flags == 2)
-				a.f[1] = get_float_reg(reg);
-			else if (flags == 3)
-				a.v[1] = get_vec_reg(reg);
-			else if (flags == 4)
-				a.fi = HASL_PUN(float, imm);
-			else if (flags == 5)
-				a.ii[0] = imm;
-			else
-				printf("Invalid second source flags %llx\n", flags);
+		// puts a program's string literals (program::get_data) where the assembler put them, in this vm's RAM, so its scripts can run on this
+		// vm. returns false if they don't fit
+		bool load_data(const data_segment& data)
+		{
+			if (data.address > RAM || data.bytes.size() > RAM - data.address)
+				return false;
+			// an empty vector's data() may be null, which memcpy doesn't take even for no bytes
+			if (!data.bytes.empty())
+				memcpy(m_memory + data.address, data.bytes.data(), data.bytes.size());
+			return true;
+		}
+		// decodes an instruction written by args::encode into a, returns false if it isn't one (an opcode or register out of range, from a
+		// damaged or crafted file). it refers to registers by index, into whichever script's context runs it, and to RAM by address, so it
+		// isn't tied to this or any other vm
+		static bool deserialize(uint64_t word, uint64_t immediate, args* const a)
+		{
+			*a = args::decode(word, immediate);
+			// quicken passes an opcode it doesn't know through as the handler, which could name an unchecked one
+			if (a->opcode >= s_opcode_count)
+				return false;
+			a->handler = quicken(*a);
+			return is_valid(*a);
+		}
+		// replaces common instruction sequences in s's program (so in every script that runs it) with superinstructions, returns how many were
+		// formed. the rest of each sequence is left in place (and still runs on its own if something branches into it), so label targets stay
+		// valid
+		static size_t fuse(script<STACK, RAM>& s)
+		{
+			size_t count = 0;
+			const std::span<args> code = s.m_instructions;
+			for (size_t i = 0; i < code.size(); i++)
+			{
+				for (const fusion& f : s_fusions)
+				{
+					if (i + f.parts.size() > code.size())
+						continue;
 
-			return a;
+					bool match = true;
+					for (size_t j = 0; j < f.parts.size() && match; j++)
+						match = checked(code[i + j].handler) == HASL_CAST(uint16_t, f.parts[j]);
+					if (!match)
+						continue;
+
+					code[i].handler = HASL_CAST(uint16_t, f.fused);
+					// the other parts can't start a superinstruction of their own
+					i += f.parts.size() - 1;
+					count++;
+					break;
+				}
+			}
+			return count;
+		}
+		// picks the handler of every instruction in code again from the instruction itself, for code whose handlers were written by someone
+		// else (see deserialize). a superinstruction is kept only where the instructions it stands for are still there, and the verifier's
+		// unchecked forms are put back to checked ones, for it to prove again. every instruction has to be is_valid
+		static void reselect(std::span<args> code)
+		{
+			for (size_t i = 0; i < code.size(); i++)
+			{
+				const uint16_t stored = code[i].handler;
+				code[i].handler = quicken(code[i]);
+				// the handler it had, or its unchecked form
+				if (checked(stored) == code[i].handler)
+					continue;
+				for (const fusion& f : s_fusions)
+				{
+					if (HASL_CAST(uint16_t, f.fused) != stored || i + f.parts.size() > code.size())
+						continue;
+					bool match = true;
+					for (size_t j = 0; j < f.parts.size() && match; j++)
+						match = quicken(code[i + j]) == HASL_CAST(uint16_t, f.parts[j]);
+					if (match)
+						code[i].handler = stored;
+					break;
+				}
+			}
+		}
+		// compile a program to native code once its scripts have run it this many times in all (0 never compiles anything)
+		void set_jit_threshold(size_t runs)
+		{
+			m_jit_threshold = runs;
+		}
+		// instructions a script may run per call to run before it's preempted, to carry on where it stopped on the next call (0 is unlimited).
+		// native code (jit or aot) is charged by loop iteration instead: the length of the loop every time a branch goes back
+		void set_instruction_budget(size_t instructions)
+		{
+			m_instruction_budget = instructions;
+		}
+		// counts every run in p from now on (nullptr stops). while it's set, scripts are interpreted one instruction at a time instead of
+		// running as native code, and superinstructions are split back into their parts, so runs are slower and each part uses up budget
+		void set_profiler(profiler<STACK, RAM>* const p)
+		{
+			m_profiler = p;
+		}
+		// records runs, engine hooks, process_spawn_queue, and sleeps in t from now on (nullptr stops)
+		void set_tracer(tracer* const t)
+		{
+			m_tracer = t;
+		}
+		// every instruction the assembler accepts, by name
+		static const string_map<command_description>& get_command_descriptions()
+		{
+			initialize();
+			return s_command_descriptions;
+		}
+		static const char* handler_name(uint16_t handler)
+		{
+			return handler < HASL_CAST(uint16_t, op::count) ? s_handler_names[handler] : "?";
+		}
+		// FNV-1a of every handler's name and the size of args, which identifies how this build numbers handlers (see bytecode_header)
+		static uint64_t handler_fingerprint()
+		{
+			static const uint64_t fingerprint = []()
+			{
+				const uint8_t size = HASL_CAST(uint8_t, sizeof(args));
+				uint64_t h = fnv1a(&size, sizeof(size));
+				// with its terminator, so the names can't run together
+				for (const char* name : s_handler_names)
+					h = fnv1a(name, strlen(name) + 1, h);
+				return h;
+			}();
+			return fingerprint;
+		}
+		// whether a's handler and registers are in range, for instructions that weren't decoded by the vm (see deserialize)
+		static bool is_valid(const args& a)
+		{
+			if (a.handler >= HASL_CAST(uint16_t, op::count) || a.opcode >= s_opcode_count)
+				return false;
+			for (size_t i = 0; i < c::command_reg_count; i++)
+			{
+				const size_t index = a.r[i];
+				switch (a.type(i))
+				{
+				case reg_type::I:
+					if (index >= c::int_reg_count)
+						return false;
+					break;
+				case reg_type::F:
+					if (index >= c::float_reg_count)
+						return false;
+					break;
+				case reg_type::V:
+					if (index >= c::vec_reg_count)
+						return false;
+					break;
+				default:
+					break;
+				}
+			}
+			return true;
+		}
+		// the checked form of an unchecked handler (see verifier.h), any other handler is returned as is
+		static uint16_t checked(uint16_t handler)
+		{
+#define X(name) case op::name##_u: return HASL_CAST(uint16_t, op::name);
+			switch (HASL_CAST(op, handler))
+			{
+				HASL_SASM_UNCHECKED_HANDLERS(X)
+			default:
+				return handler;
+			}
+#undef X
+		}
+		// whether a can move the program counter or stop the script
+		static bool is_control(const args& a)
+		{
+			switch (HASL_CAST(op, a.opcode))
+			{
+			case op::beq: case op::beqz: case op::bne: case op::blt: case op::bgt: case op::ble: case op::bge:
+			case op::j: case op::call: case op::ret: case op::end: case op::slp:
+				return true;
+			default:
+				return false;
+			}
+		}
+		// whether a can stop the script (a failed range check, stack overflow/underflow, end, or slp)
+		static bool can_abort(const args& a)
+		{
+			switch (HASL_CAST(op, a.opcode))
+			{
+			case op::psh: case op::pop: case op::stm: case op::ldm:
+				return true;
+			default:
+				return is_control(a);
+			}
 		}
 	protected:
-		// stack
-		i_t m_stack[STACK];
-		// RAM
+		// RAM (shared by every script run on this vm)
 		uint8_t m_memory[RAM];
-		// registers
-		registers m_regs;
-		// program counter, stack pointer
-		size_t m_pc, m_sp;
+		// objects spawned by the script that just ran, for process_spawn_queue
 		std::vector<scriptable*> m_spawn_queue;
+		size_t m_jit_threshold;
+		size_t m_instruction_budget;
+		// see set_profiler
+		profiler<STACK, RAM>* m_profiler;
+		// see set_tracer
+		tracer* m_tracer;
+		// threads for run_batch, created on first use
+		std::unique_ptr<executor> m_executor;
 	protected:
 		virtual scriptable* spawn(const char* s) = 0;
 		virtual void process_spawn_queue(script_runtime& rt) = 0;
@@ -116,471 +335,1085 @@ namespace hasl::sasm
 		virtual v_t get_mouse_scroll() const = 0;
 		i_t run(script<STACK, RAM>& s, script_runtime& rt)
 		{
-			if (!s.m_assembled)
-			{
-				HASL_ASSERT(false, "Cannot run a script that failed to compile");
+			return run(s, rt, m_instruction_budget);
+		}
+		// run with its own instruction budget (0 is unlimited)
+		i_t run(script<STACK, RAM>& s, script_runtime& rt, size_t budget)
+		{
+			if (!invoke(s, rt, budget))
 				return 0;
-			}
+			// process_spawn_queue can destroy s
+			const i_t flag = s.m_context.regs.i[c::reg_flag];
+			hand_over_spawns(s, rt);
+			return flag;
+		}
+		// a script to run as part of a batch
+		struct job
+		{
+			script<STACK, RAM>* s;
+			script_runtime* rt;
+		};
+		// runs every job (like run), spread over a pool of threads, and returns their reg_flags in the same order. the scripts only share the vm's
+		// RAM and hooks: each job needs its own script, the hooks and scriptables they reach must be safe to use from several threads, and
+		// jobs that spawn objects need their own script_runtime. process_spawn_queue is still only called on this thread, in job order.
+		std::vector<i_t> run_batch(const std::vector<job>& jobs)
+		{
+			if (!m_executor)
+				m_executor = std::make_unique<executor>();
 
-			// script is still sleeping
-			if (rt.current_time < s.m_sleep_end)
-				return 0;
+			std::vector<i_t> flags(jobs.size(), 0);
+			std::vector<uint8_t> ran(jobs.size(), false);
+			m_executor->run(jobs.size(), [&](size_t i)
+			{
+				ran[i] = invoke(*jobs[i].s, *jobs[i].rt, m_instruction_budget);
+				if (ran[i])
+					flags[i] = jobs[i].s->m_context.regs.i[c::reg_flag];
+			});
 
-			// restart from entry point unless sleeping
-			if (!s.m_sleeping)
-				m_pc = s.m_entry_point;
+			for (size_t i = 0; i < jobs.size(); i++)
+				if (ran[i])
+					hand_over_spawns(*jobs[i].s, *jobs[i].rt);
+			return flags;
+		}
+		// runs every job (like run) in lockstep groups that share one program counter, with arithmetic done across the group at once (see
+		// lanes.h). for many copies of the same script with different hosts; a job whose script isn't the same program as the first one's is
+		// just run on its own. returns the reg_flags in the same order
+		std::vector<i_t> run_lanes(const std::vector<job>& jobs)
+		{
+			return lanes<STACK, RAM>::run(*this, jobs);
+		}
+		// number of threads run_batch uses, including the calling thread (0 is one per hardware thread)
+		void set_thread_count(size_t count)
+		{
+			m_executor = std::make_unique<executor>(count);
+		}
+	private:
+		// fills in the instruction tables the first time it's called, on any thread (the assembler uses them without a vm)
+		static void initialize()
+		{
+			const static bool initialized = []()
+			{
+				for (size_t i = 0; i < s_instructions.size(); i++)
+				{
+					const instruction& cur = s_instructions[i];
+					s_command_names.emplace(i, cur.name);
+					s_command_descriptions.emplace(cur.name, command_description(HASL_CAST(uint8_t, i), cur.desc));
+				}
+				// execute() dispatches through HASL_SASM_HANDLERS, so it must list the same handlers in the same order
+#define X(name) &vm::name,
+				const operation handlers[] = { HASL_SASM_HANDLERS(X) };
+#undef X
+				HASL_ASSERT(s_instructions.size() == s_opcode_count, "HASL_SASM_HANDLERS does not match the instruction table");
+				for (size_t i = 0; i < s_instructions.size(); i++)
+					HASL_ASSERT(s_instructions[i].op == handlers[i], "HASL_SASM_HANDLERS does not match the instruction table");
+				return true;
+			}();
+			(void)initialized;
+		}
+		// runs (or resumes) s until it stops or runs out of budget, returns false if it couldn't run. only touches s and RAM, so it can run on
+		// any thread
+		bool invoke(script<STACK, RAM>& s, script_runtime& rt, size_t budget)
+		{
+			const bool woke = s.m_context.sleeping;
+			const bool resumed = woke || s.m_context.preempted;
+			if (!prepare(s, rt))
+				return false;
 
-			s.m_sleeping = false;
-			s.m_abort = false;
-			m_regs.i[c::reg_hst] = c::host_index;
-			m_regs.i[c::reg_oc] = rt.env.size();
-			m_regs.i[c::reg_flag] = 0;
+			program<STACK, RAM>& p = *s.m_program;
+			const char* const name = p.m_filepath.c_str();
+			if (m_tracer)
+			{
+				if (woke)
+					m_tracer->record(tracer::phase::ASYNC_END, "slp", name, HASL_CAST(uint64_t, reinterpret_cast<uintptr_t>(&s)));
+				m_tracer->record(tracer::phase::BEGIN, "run", name);
+			}
 
-			while (!s.m_abort && m_pc < s.m_instructions.size())
+			jit_code* native = p.m_jit.load(std::memory_order_acquire);
+			if (m_jit_threshold && !p.m_aot && !native && ++p.m_run_count >= m_jit_threshold && !p.m_compiling.exchange(true))
 			{
-				const args& cur = s.m_instructions[m_pc];
-				(this->*(s_operations[cur.opcode]))(&s, cur, rt.current_time, rt.delta_time, rt.host, rt.env);
-				m_pc++;
+				p.m_native = jit<STACK, RAM>::compile(p);
+				native = p.m_native.get();
+				p.m_jit.store(native, std::memory_order_release);
 			}
 
-			process_spawn_queue(rt);
-			m_spawn_queue.clear();
+			context<STACK>& ctx = s.m_context;
+			const int64_t limit = budget ? HASL_CAST(int64_t, std::min(budget, HASL_CAST(size_t, std::numeric_limits<int64_t>::max()))) :
+				std::numeric_limits<int64_t>::max();
+			int64_t left = limit;
+			if (m_profiler)
+				left = profile(s, rt, limit, resumed);
+			else if (p.m_aot)
+			{
+				typename aot<STACK, RAM>::frame f = { this, &s, &rt, &ctx.regs, limit };
+				p.m_aot(f);
+				left = f.budget;
+			}
+			else if (native && native->valid())
+			{
+				typename jit<STACK, RAM>::frame f = { this, &s, &rt, &ctx.regs, limit };
+				(*native)(&f, ctx.pc);
+				left = f.budget;
+			}
+			else if (budget)
+				left = execute<true>(s, rt, limit);
+			else
+				execute<false>(s, rt, limit);
 
-			return m_regs.i[c::reg_flag];
-		}
-	private:
-		i_t* const get_int_reg(size_t i)
-		{
-			HASL_ASSERT(i >= c::first_int_reg && i <= c::last_int_reg, "Invalid int register index");
-			return &m_regs.i[i - c::first_int_reg];
+			// stopped in the middle, rather than by end, slp, an error, or falling off the end
+			ctx.executed = budget ? HASL_CAST(size_t, limit - left) : 0;
+			ctx.preempted = left <= 0 && !ctx.abort && ctx.pc < s.m_instructions.size();
+
+			if (m_tracer)
+			{
+				m_tracer->record(tracer::phase::END, "run", name);
+				if (ctx.sleeping)
+					m_tracer->record(tracer::phase::ASYNC_BEGIN, "slp", name, HASL_CAST(uint64_t, reinterpret_cast<uintptr_t>(&s)));
+			}
+			return true;
 		}
-		f_t* const get_float_reg(size_t i)
+		// sets s up to run (or resume), returns false if it can't run yet
+		bool prepare(script<STACK, RAM>& s, script_runtime& rt)
 		{
-			HASL_ASSERT(i >= c::first_float_reg && i <= c::last_float_reg, "Invalid float register index");
-			return &m_regs.f[i - c::first_float_reg];
+			const program<STACK, RAM>& p = *s.m_program;
+			if (!p.m_assembled)
+			{
+				HASL_ASSERT(false, "Cannot run a script that failed to compile");
+				return false;
+			}
+			if (!p.m_symbols.imports.empty())
+			{
+				HASL_ASSERT(false, "Cannot run a script that imports labels before it's linked");
+				return false;
+			}
+
+			context<STACK>& ctx = s.m_context;
+			// script is still sleeping
+			if (rt.current_time < ctx.sleep_end)
+				return false;
+
+			// restart from entry point unless sleeping or preempted
+			const bool preempted = ctx.preempted;
+			if (!ctx.sleeping && !preempted)
+			{
+				// the verifier took the stack checks out of psh and call, assuming the run has this much room left
+				if (p.m_stack_need != verifier<STACK, RAM>::s_unbounded && ctx.sp > STACK - p.m_stack_need)
+				{
+					HASL_ASSERT(false, "Stack overflow");
+					return false;
+				}
+				ctx.pc = p.m_entry_point;
+			}
+
+			ctx.sleeping = false;
+			ctx.preempted = false;
+			ctx.abort = false;
+			ctx.executed = 0;
+			ctx.spawned.clear();
+			ctx.regs.i[c::reg_hst] = c::host_index;
+			ctx.regs.i[c::reg_oc] = rt.env.size();
+			// a preempted run is the same run carried on, so it keeps the flag it had set so far
+			if (!preempted)
+				ctx.regs.i[c::reg_flag] = 0;
+			return true;
 		}
-		v_t* const get_vec_reg(size_t i)
+		// gives the objects s spawned during its last run to the engine
+		void hand_over_spawns(script<STACK, RAM>& s, script_runtime& rt)
 		{
-			HASL_ASSERT(i >= c::first_vec_reg && i <= c::last_vec_reg, "Invalid vec register index");
-			return &m_regs.v[i - c::first_vec_reg];
+			m_spawn_queue.swap(s.m_context.spawned);
+			{
+				const tracer::span t(m_tracer, "engine", "process_spawn_queue");
+				process_spawn_queue(rt);
+			}
+			m_spawn_queue.clear();
 		}
 		bool range_check(script<STACK, RAM>* const s, i_t i, i_t min, i_t max)
 		{
-			if (s->m_abort = (i < min || i >= max))
+			if (s->m_context.abort = (i < min || i >= max))
 			{
 				HASL_ASSERT(false, "Range check failed");
 				return false;
 			}
 			return true;
 		}
-		template<typename T>
+		// CHECKED is false in the handlers the verifier only picks when the stack can't overflow or underflow there
+		template<bool CHECKED = true, typename T>
 		void stack_push(script<STACK, RAM>* const s, const T& t)
 		{
-			if (s->m_abort = (m_sp >= STACK))
+			if (CHECKED && (s->m_context.abort = (s->m_context.sp >= STACK)))
 			{
 				HASL_ASSERT(false, "Stack overflow");
 				return;
 			}
-			m_stack[m_sp++] = HASL_PUN(i_t, t);
+			s->m_context.stack[s->m_context.sp++] = HASL_PUN(i_t, t);
 		}
-		template<typename T>
+		template<typename T, bool CHECKED = true>
 		T stack_pop(script<STACK, RAM>* const s)
 		{
-			if (s->m_abort = (m_sp == 0))
+			if (CHECKED && (s->m_context.abort = (s->m_context.sp == 0)))
 			{
 				HASL_ASSERT(false, "Stack underflow");
 				return HASL_CAST(T, 0);
 			}
-			return HASL_PUN(T, m_stack[--m_sp]);
-		}
-		static args deserialize_base(uint64_t i)
-		{
-			args a;
-			a.opcode = (i & 0xff00000000000000) >> 56;
-			return a;
-		}
-		void deserialize_reg(args& a, uint64_t byte, size_t index)
-		{
-			uint64_t flags = (byte & 0xc0), reg = (byte & 0x3f);
-			if (flags == 0x40)
-				a.i[index] = get_int_reg(reg);
-			else if (flags == 0x80)
-				a.f[index] = get_float_reg(reg);
-			else if (flags == 0xc0)
-				a.v[index] = get_vec_reg(reg);
-			else if (flags != 0)
-				printf("Invalid reg %zu type %llx\n", index, flags);
+			return HASL_PUN(T, s->m_context.stack[--s->m_context.sp]);
 		}
 	private:
 		// instruction signature
 #define I(name, code) \
-	void name(script<STACK, RAM>* const s, const args& a, float ct, float dt, scriptable* const host, std::vector<scriptable*>& env) { code }
-		// register's value if it exists, OR something else
-#define R(r, o) ((r) ? (*r) : (o))
+	void name(script<STACK, RAM>* const s, const args& a, script_runtime& rt) { code }
+		// register in slot n
+#define RI(n) s->m_context.regs.i[a.r[n]]
+#define RF(n) s->m_context.regs.f[a.r[n]]
+#define RV(n) s->m_context.regs.v[a.r[n]]
+		// slot n holds a register of type t
+#define IS(n, t) (a.type(n) == reg_type::t)
+		// value of slot n's type t register if it exists, OR something else
+#define R(t, n, o) (IS(n, t) ? R##t(n) : (o))
 
 
 		// math
 		I(add,
-			*a.i[2] = *a.i[0] + R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) + R(I, 1, a.ii);
 		);
 		I(addf,
-			*a.f[2] = *a.f[0] + R(a.f[1], a.fi);
+			RF(2) = RF(0) + R(F, 1, a.fi);
 		);
 		I(addv,
-			*a.v[2] = *a.v[0] + R(a.v[1], R(a.f[1], a.fi));
+			RV(2) = RV(0) + R(V, 1, R(F, 1, a.fi));
 		);
 		I(sub,
-			*a.i[2] = *a.i[0] - R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) - R(I, 1, a.ii);
 		);
 		I(subf,
-			*a.f[2] = *a.f[0] - R(a.f[1], a.fi);
+			RF(2) = RF(0) - R(F, 1, a.fi);
 		);
 		I(subv,
-			*a.v[2] = *a.v[0] - R(a.v[1], R(a.f[1], a.fi));
+			RV(2) = RV(0) - R(V, 1, R(F, 1, a.fi));
 		);
 		I(mul,
-			*a.i[2] = *a.i[0] * R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) * R(I, 1, a.ii);
 		);
 		I(mulf,
-			*a.f[2] = *a.f[0] * R(a.f[1], a.fi);
+			RF(2) = RF(0) * R(F, 1, a.fi);
 		);
 		I(mulv,
-			*a.v[2] = *a.v[0] * R(a.v[1], R(a.f[1], a.fi));
+			RV(2) = RV(0) * R(V, 1, R(F, 1, a.fi));
 		);
 		I(div,
-			*a.i[2] = *a.i[0] / R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) / R(I, 1, a.ii);
 		);
 		I(divf,
-			*a.f[2] = *a.f[0] / R(a.f[1], a.fi);
+			RF(2) = RF(0) / R(F, 1, a.fi);
 		);
 		I(divv,
-			*a.v[2] = *a.v[0] / R(a.v[1], R(a.f[1], a.fi));
+			RV(2) = RV(0) / R(V, 1, R(F, 1, a.fi));
 		);
 		// math.bit
 		I(band,
-			*a.i[2] = *a.i[0] & R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) & R(I, 1, a.ii);
 		);
 		I(bxor,
-			*a.i[2] = *a.i[0] ^ R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) ^ R(I, 1, a.ii);
 		);
 		I(bor,
-			*a.i[2] = *a.i[0] | R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) | R(I, 1, a.ii);
 		);
 		I(bnot,
-			*a.i[1] = ~R(a.i[0], a.ii[0]);
+			RI(1) = ~R(I, 0, a.ii);
 		);
 		I(sl,
-			*a.i[2] = (*a.i[0]) << R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) << R(I, 1, a.ii);
 		);
 		I(sr,
-			*a.i[2] = (*a.i[0]) >> R(a.i[1], a.ii[0]);
+			RI(2) = RI(0) >> R(I, 1, a.ii);
 		);
 		// math.trig
 		I(sine,
-			*a.f[1] = std::sin(*a.f[0]);
+			RF(1) = std::sin(RF(0));
 		);
 		I(cosine,
-			*a.f[1] = std::cos(*a.f[0]);
+			RF(1) = std::cos(RF(0));
 		);
 		I(tangent,
-			*a.f[1] = std::tan(*a.f[0]);
+			RF(1) = std::tan(RF(0));
 		);
 		I(arcsine,
-			*a.f[1] = std::asin(*a.f[0]);
+			RF(1) = std::asin(RF(0));
 		);
 		I(arccosine,
-			*a.f[1] = std::acos(*a.f[0]);
+			RF(1) = std::acos(RF(0));
 		);
 		I(arctangent,
-			*a.f[2] = std::atan2(*a.f[1], *a.f[0]);
+			RF(2) = std::atan2(RF(1), RF(0));
 		);
 		// math.fn
 		I(min,
-			*a.i[2] = std::min(*a.i[0], R(a.i[1], a.ii[0]));
+			RI(2) = std::min(RI(0), R(I, 1, a.ii));
 		);
 		I(max,
-			*a.i[2] = std::max(*a.i[0], R(a.i[1], a.ii[0]));
+			RI(2) = std::max(RI(0), R(I, 1, a.ii));
 		);
 		I(minf,
-			*a.f[2] = std::min(*a.f[0], R(a.f[1], a.fi));
+			RF(2) = std::min(RF(0), R(F, 1, a.fi));
 		);
 		I(maxf,
-			*a.f[2] = std::max(*a.f[0], R(a.f[1], a.fi));
+			RF(2) = std::max(RF(0), R(F, 1, a.fi));
 		);
 		I(minv,
-			*a.f[1] = std::min(a.v[0]->x, a.v[0]->y);
+			RF(1) = std::min(RV(0).x, RV(0).y);
 		);
 		I(maxv,
-			*a.f[1] = std::max(a.v[0]->x, a.v[0]->y);
+			RF(1) = std::max(RV(0).x, RV(0).y);
 		);
 		I(power,
-			*a.f[2] = std::pow(*a.f[0], R(a.f[1], a.fi));
+			RF(2) = std::pow(RF(0), R(F, 1, a.fi));
 		);
 		I(squareroot,
-			*a.f[1] = std::sqrt(R(a.f[0], a.fi));
+			RF(1) = std::sqrt(R(F, 0, a.fi));
 		);
 		I(absolute,
-			*a.i[1] = std::abs(R(a.i[0], a.ii[0]));
+			RI(1) = std::abs(R(I, 0, a.ii));
 		);
 		I(absolutef,
-			*a.f[1] = std::abs(R(a.f[0], a.fi));
+			RF(1) = std::abs(R(F, 0, a.fi));
 		);
 		I(absolutev,
-			*a.v[1] = a.v[0]->abs();
+			RV(1) = RV(0).abs();
 		);
 		I(random,
-			*a.i[2] = rand(*a.i[0], R(a.i[1], a.ii[0]));
+			RI(2) = rand(RI(0), R(I, 1, a.ii));
 		);
 		I(randomf,
-			*a.f[2] = rand(*a.f[0], R(a.f[1], a.fi));
+			RF(2) = rand(RF(0), R(F, 1, a.fi));
 		);
 		I(sign,
-			*a.i[1] = hasl::sign(R(a.i[0], a.ii[0]));
+			RI(1) = hasl::sign(R(I, 0, a.ii));
 		);
 		I(signf,
-			*a.f[1] = hasl::sign(R(a.f[0], a.fi));
+			RF(1) = hasl::sign(R(F, 0, a.fi));
 		);
 		I(signv,
-			*a.v[1] = a.v[0]->unit();
+			RV(1) = RV(0).unit();
 		);
 		// math.v_t
 		I(dot,
-			*a.f[2] = a.v[0]->dot(*a.v[1]);
+			RF(2) = RV(0).dot(RV(1));
 		);
 		I(mag,
-			*a.f[1] = a.v[0]->magnitude();
+			RF(1) = RV(0).magnitude();
 		);
 		I(ang,
-			*a.f[1] = rad_to_deg(a.v[0]->angle());
+			RF(1) = rad_to_deg(RV(0).angle());
 		);
 		I(angv,
-			*a.f[2] = rad_to_deg(a.v[0]->angle_between(*a.v[1]));
+			RF(2) = rad_to_deg(RV(0).angle_between(RV(1)));
 		);
 		I(norm,
-			*a.v[1] = a.v[0]->normalized();
+			RV(1) = RV(0).normalized();
 		);
 		// mem
 		I(psh,
-			if (a.i[0])
-				stack_push(s, *a.i[0]);
-			else if (a.f[0])
-				stack_push(s, *a.f[0]);
+			if (IS(0, I))
+				stack_push(s, RI(0));
+			else if (IS(0, F))
+				stack_push(s, RF(0));
 			else
-				stack_push(s, *a.v[0]);
+				stack_push(s, RV(0));
 		);
 		I(pop,
-			if (a.i[0])
-				*a.i[0] = stack_pop<i_t>(s);
-			else if (a.f[0])
-				*a.f[0] = stack_pop<f_t>(s);
+			if (IS(0, I))
+				RI(0) = stack_pop<i_t>(s);
+			else if (IS(0, F))
+				RF(0) = stack_pop<f_t>(s);
 			else
-				*a.v[0] = stack_pop<v_t>(s);
+				RV(0) = stack_pop<v_t>(s);
 		);
 		I(mov,
-			*a.i[1] = HASL_CAST(i_t, R(a.f[0], R(a.i[0], a.ii[0])));
+			RI(1) = HASL_CAST(i_t, R(F, 0, R(I, 0, a.ii)));
 		);
 		I(movl,
-			*a.i[1] &= c::reg_hi_mask;
-			*a.i[1] |= R(a.i[0], a.ii[0]);
+			RI(1) &= c::reg_hi_mask;
+			RI(1) |= R(I, 0, a.ii);
 		);
 		I(movh,
-			*a.i[1] &= c::reg_lo_mask;
-			*a.i[1] |= (R(a.i[0], a.ii[0]) << 32);
+			RI(1) &= c::reg_lo_mask;
+			RI(1) |= (R(I, 0, a.ii) << 32);
 		);
 		I(movf,
-			*a.f[1] = HASL_CAST(f_t, R(a.f[0], R(a.i[0], a.fi)));
+			RF(1) = HASL_CAST(f_t, R(F, 0, R(I, 0, a.fi)));
 		);
 		I(movv,
-			*a.v[1] = R(a.v[0], R(a.i[0], R(a.f[0], a.fi)));
+			RV(1) = R(V, 0, R(I, 0, R(F, 0, a.fi)));
 		);
 		I(movx,
-			if (a.v[0])
-				a.v[1]->x = a.v[0]->x;
+			if (IS(0, V))
+				RV(1).x = RV(0).x;
 			else
-				a.v[1]->x = HASL_CAST(float, R(a.i[0], R(a.f[0], a.fi)));
+				RV(1).x = HASL_CAST(float, R(I, 0, R(F, 0, a.fi)));
 		);
 		I(movy,
-			if (a.v[0])
-				a.v[1]->y = a.v[0]->y;
+			if (IS(0, V))
+				RV(1).y = RV(0).y;
 			else
-				a.v[1]->y = HASL_CAST(float, R(a.i[0], R(a.f[0], a.fi)));
+				RV(1).y = HASL_CAST(float, R(I, 0, R(F, 0, a.fi)));
 		);
 		I(stm,
-			const i_t index = R(a.i[1], a.ii[0]);
+			const i_t index = R(I, 1, a.ii);
 			if (!range_check(s, index, 0, RAM))
 				return;
 
 			// write to memory in chunks of 8 bytes by HASL_CASTing to a uint64_t pointer
-			if (a.i[0])
-				*((uint64_t*)(&m_memory[index])) = *(uint64_t*)a.i[0];
-			else if (a.f[0])
-				*((uint64_t*)(&m_memory[index])) = *(uint64_t*)a.f[0];
-			else if (a.v[0])
-				*((uint64_t*)(&m_memory[index])) = *(uint64_t*)a.v[0];
+			if (IS(0, I))
+				*((uint64_t*)(&m_memory[index])) = *(uint64_t*)&RI(0);
+			else if (IS(0, F))
+				*((uint64_t*)(&m_memory[index])) = *(uint64_t*)&RF(0);
+			else if (IS(0, V))
+				*((uint64_t*)(&m_memory[index])) = *(uint64_t*)&RV(0);
 		);
 		I(ldm,
-			const i_t index = R(a.i[1], a.ii[0]);
+			const i_t index = R(I, 0, a.ii);
 			if (!range_check(s, index, 0, RAM))
 				return;
 
-			if (a.i[1])
-				*a.i[1] = HASL_PUN(i_t, m_memory[index]);
-			else if (a.f[1])
-				*a.f[1] = HASL_PUN(f_t, m_memory[index]);
-			else if (a.v[1])
-				*a.v[1] = HASL_PUN(v_t, m_memory[index]);
+			if (IS(1, I))
+				RI(1) = HASL_PUN(i_t, m_memory[index]);
+			else if (IS(1, F))
+				RF(1) = HASL_PUN(f_t, m_memory[index]);
+			else if (IS(1, V))
+				RV(1) = HASL_PUN(v_t, m_memory[index]);
 		);
 		// ctrl
 		I(beq,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], R(a.f[0], *a.v[0])) == R(a.i[1], R(a.f[1], *a.v[1])))
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, R(F, 0, RV(0))) == R(I, 1, R(F, 1, RV(1))))
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(beqz,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], R(a.f[0], *a.v[0])) == 0)
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, R(F, 0, RV(0))) == 0)
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(bne,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], R(a.f[0], *a.v[0])) != R(a.i[1], R(a.f[1], *a.v[1])))
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, R(F, 0, RV(0))) != R(I, 1, R(F, 1, RV(1))))
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(blt,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], *a.f[0]) < R(a.i[1], *a.f[1]))
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, RF(0)) < R(I, 1, RF(1)))
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(bgt,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], *a.f[0]) > R(a.i[1], *a.f[1]))
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, RF(0)) > R(I, 1, RF(1)))
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(ble,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], *a.f[0]) <= R(a.i[1], *a.f[1]))
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, RF(0)) <= R(I, 1, RF(1)))
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(bge,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
 
-			if (R(a.i[0], *a.f[0]) >= R(a.i[1], *a.f[1]))
-				m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			if (R(I, 0, RF(0)) >= R(I, 1, RF(1)))
+				s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(j,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
-			m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(call,
-			if (!range_check(s, a.ii[0], 0, s->m_instructions.size()))
+			if (!range_check(s, a.ii, 0, s->m_instructions.size()))
 				return;
-			stack_push(s, m_pc);
-			m_pc = HASL_CAST(size_t, a.ii[0]) - 1;
+			stack_push(s, s->m_context.pc);
+			s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
 		);
 		I(ret,
-			m_pc = stack_pop<size_t>(s);
+			s->m_context.pc = stack_pop<size_t>(s);
 		);
 		I(end,
-			s->m_abort = true;
+			s->m_context.abort = true;
 		);
 		I(slp,
-			s->m_sleep_end = ct + R(a.i[0], a.ii[0]);
-			s->m_sleeping = true;
-			s->m_abort = true;
+			s->m_context.sleep_end = rt.current_time + R(I, 0, a.ii);
+			s->m_context.sleeping = true;
+			s->m_context.abort = true;
 		);
 		I(blk,
-			sleep(HASL_CAST(size_t, R(a.i[0], a.ii[0])));
+			sleep(HASL_CAST(size_t, R(I, 0, a.ii)));
 		);
 		// debug
 		I(dbg,
-			printf("[HASL@%s]: %lld\n", s->m_filepath.c_str(), R(a.i[0], a.ii[0]));
+			printf("[HASL@%s]: %lld\n", s->m_program->m_filepath.c_str(), R(I, 0, a.ii));
 		);
 		I(dbgf,
-			printf("[HASL@%s]: %f\n", s->m_filepath.c_str(), R(a.f[0], a.fi));
+			printf("[HASL@%s]: %f\n", s->m_program->m_filepath.c_str(), R(F, 0, a.fi));
 		);
 		I(dbgv,
-			printf("[HASL@%s]: <%f, %f>\n", s->m_filepath.c_str(), a.v[0]->x, a.v[0]->y);
+			printf("[HASL@%s]: <%f, %f>\n", s->m_program->m_filepath.c_str(), RV(0).x, RV(0).y);
 		);
 		I(dbgs,
-			printf("[HASL@%s]: %s\n", s->m_filepath.c_str(), (char*)(m_memory + R(a.i[0], a.ii[0])));
+			printf("[HASL@%s]: %s\n", s->m_program->m_filepath.c_str(), (char*)(m_memory + R(I, 0, a.ii)));
 		);
 		// engine
 		I(gettime,
-			*a.f[0] = ct;
+			RF(0) = rt.current_time;
 		);
+		// an engine hook, recorded as a slice of the run if tracing
+#define HOOK(name) const tracer::span hook(m_tracer, "hook", #name)
 		// engine.input
 		I(imp,
-			*a.v[0] = get_mouse_pos();
+			HOOK(imp);
+			RV(0) = get_mouse_pos();
 		);
 		I(ims,
-			*a.v[0] = get_mouse_scroll();
+			HOOK(ims);
+			RV(0) = get_mouse_scroll();
 		);
 		I(imb,
-			*a.i[1] = HASL_CAST(i_t, is_mouse_pressed(R(a.i[0], a.ii[0])));
+			HOOK(imb);
+			RI(1) = HASL_CAST(i_t, is_mouse_pressed(R(I, 0, a.ii)));
 		);
 		I(ikp,
-			*a.i[1] = HASL_CAST(i_t, is_key_pressed(R(a.i[0], a.ii[0])));
+			HOOK(ikp);
+			RI(1) = HASL_CAST(i_t, is_key_pressed(R(I, 0, a.ii)));
 		);
 		I(ikd,
-			const i_t x = HASL_CAST(i_t, is_key_pressed(R(a.i[0], a.ii[0])));
-			const i_t y = HASL_CAST(i_t, is_key_pressed(R(a.i[1], a.ii[1])));
-			*a.i[2] = x - y;
+			HOOK(ikd);
+			const i_t x = HASL_CAST(i_t, is_key_pressed(R(I, 0, a.si[0])));
+			const i_t y = HASL_CAST(i_t, is_key_pressed(R(I, 1, a.si[1])));
+			RI(2) = x - y;
 		);
 		// engine.obj
-#define CS (m_regs.i[c::reg_obj] == c::host_index ? host : env[m_regs.i[c::reg_obj]])
+#define CS (s->m_context.regs.i[c::reg_obj] == c::host_index ? rt.host : rt.env[s->m_context.regs.i[c::reg_obj]])
 		I(ogp,
-			*a.v[0] = CS->get_pos();
+			HOOK(ogp);
+			RV(0) = CS->get_pos();
 		);
 		I(osp,
-			CS->set_pos(*a.v[0]);
+			HOOK(osp);
+			CS->set_pos(RV(0));
 		);
 		I(ogv,
-			*a.v[0] = CS->get_vel();
+			HOOK(ogv);
+			RV(0) = CS->get_vel();
 		);
 		I(osv,
-			CS->set_vel(*a.v[0]);
+			HOOK(osv);
+			CS->set_vel(RV(0));
 		);
 		I(ogd,
-			*a.v[0] = CS->get_dims();
+			HOOK(ogd);
+			RV(0) = CS->get_dims();
 		);
 		I(ogs,
-			*a.f[0] = CS->get_speed();
+			HOOK(ogs);
+			RF(0) = CS->get_speed();
 		);
 		I(oss,
-			CS->set_state((char*)(m_memory + R(a.i[0], a.ii[0])));
+			HOOK(oss);
+			CS->set_state((char*)(m_memory + R(I, 0, a.ii)));
 		);
 		I(spn,
-			scriptable* spawned = spawn((char*)(m_memory + R(a.i[0], a.ii[0])));
+			HOOK(spn);
+			scriptable* spawned = spawn((char*)(m_memory + R(I, 0, a.ii)));
 			// add for processing at the end of the current execution
-			m_spawn_queue.push_back(spawned);
+			s->m_context.spawned.push_back(spawned);
 			// increment current object count
-			m_regs.i[c::reg_oc]++;
+			s->m_context.regs.i[c::reg_oc]++;
 			// add to current environment
-			env.push_back(spawned);
-			*a.i[1] = env.size() - 1;
+			rt.env.push_back(spawned);
+			RI(1) = rt.env.size() - 1;
+		);
+#undef HOOK
+		// quickened forms (_r/_i: register/immediate operand; _i/_f/_v: int/float/vec register; _m: immediate)
+#define QI(name, expr) \
+	I(name##_r, const i_t x = RI(0); const i_t y = RI(1); RI(2) = (expr);) \
+	I(name##_i, const i_t x = RI(0); const i_t y = a.ii; RI(2) = (expr);)
+#define QIU(name, expr) \
+	I(name##_r, const i_t x = RI(0); RI(1) = (expr);) \
+	I(name##_i, const i_t x = a.ii; RI(1) = (expr);)
+#define QF(name, expr) \
+	I(name##_r, const f_t x = RF(0); const f_t y = RF(1); RF(2) = (expr);) \
+	I(name##_i, const f_t x = RF(0); const f_t y = a.fi; RF(2) = (expr);)
+#define QFU(name, expr) \
+	I(name##_r, const f_t x = RF(0); RF(1) = (expr);) \
+	I(name##_i, const f_t x = a.fi; RF(1) = (expr);)
+#define QV(name, o) \
+	I(name##_v, RV(2) = RV(0) o RV(1);) \
+	I(name##_f, RV(2) = RV(0) o HASL_CAST(float, RF(1));) \
+	I(name##_i, RV(2) = RV(0) o HASL_CAST(float, a.fi);)
+		// branch to the label in a.ii if cond holds (the unchecked form is for a label the verifier proved is in range)
+#define QB(name, k, cond) \
+	I(name, \
+		if (!range_check(s, a.ii, 0, s->m_instructions.size())) \
+			return; \
+		name##_u(s, a, rt); \
+	) \
+	I(name##_u, \
+		const auto& x = R##k(0); \
+		if (cond) \
+			s->m_context.pc = HASL_CAST(size_t, a.ii) - 1; \
+	)
+#define QB2(name, k, cond) QB(name, k, const auto& y = R##k(1); cond)
+
+		// math
+		QI(add, x + y);
+		QI(sub, x - y);
+		QI(mul, x * y);
+		QI(div, x / y);
+		QF(addf, x + y);
+		QF(subf, x - y);
+		QF(mulf, x * y);
+		QF(divf, x / y);
+		QV(addv, +);
+		QV(subv, -);
+		QV(mulv, *);
+		QV(divv, /);
+		// math.bit
+		QI(band, x & y);
+		QI(bxor, x ^ y);
+		QI(bor, x | y);
+		QIU(bnot, ~x);
+		QI(sl, x << y);
+		QI(sr, x >> y);
+		// math.fn
+		QI(min, std::min(x, y));
+		QI(max, std::max(x, y));
+		QF(minf, std::min(x, y));
+		QF(maxf, std::max(x, y));
+		QF(power, std::pow(x, y));
+		QFU(squareroot, std::sqrt(x));
+		QIU(absolute, std::abs(x));
+		QFU(absolutef, std::abs(x));
+		QIU(sign, hasl::sign(x));
+		QFU(signf, hasl::sign(x));
+		// mem
+		I(psh_i,
+			stack_push(s, RI(0));
+		);
+		I(psh_f,
+			stack_push(s, RF(0));
+		);
+		I(psh_v,
+			stack_push(s, RV(0));
+		);
+		I(pop_i,
+			RI(0) = stack_pop<i_t>(s);
+		);
+		I(pop_f,
+			RF(0) = stack_pop<f_t>(s);
+		);
+		I(pop_v,
+			RV(0) = stack_pop<v_t>(s);
+		);
+		I(mov_i,
+			RI(1) = RI(0);
+		);
+		I(mov_f,
+			RI(1) = HASL_CAST(i_t, RF(0));
+		);
+		I(mov_m,
+			RI(1) = a.ii;
+		);
+		I(movf_i,
+			RF(1) = HASL_CAST(f_t, RI(0));
+		);
+		I(movf_f,
+			RF(1) = RF(0);
+		);
+		I(movf_m,
+			RF(1) = a.fi;
+		);
+		I(movv_v,
+			RV(1) = RV(0);
+		);
+		I(movv_i,
+			RV(1) = HASL_CAST(f_t, RI(0));
 		);
+		I(movv_f,
+			RV(1) = RF(0);
+		);
+		I(movv_m,
+			RV(1) = a.fi;
+		);
+		I(stm_i,
+			const i_t index = R(I, 1, a.ii);
+			if (!range_check(s, index, 0, RAM))
+				return;
+			*((uint64_t*)(&m_memory[index])) = *(uint64_t*)&RI(0);
+		);
+		I(stm_f,
+			const i_t index = R(I, 1, a.ii);
+			if (!range_check(s, index, 0, RAM))
+				return;
+			*((uint64_t*)(&m_memory[index])) = *(uint64_t*)&RF(0);
+		);
+		I(stm_v,
+			const i_t index = R(I, 1, a.ii);
+			if (!range_check(s, index, 0, RAM))
+				return;
+			*((uint64_t*)(&m_memory[index])) = *(uint64_t*)&RV(0);
+		);
+		// ctrl
+		QB2(beq_i, I, x == y);
+		QB2(beq_f, F, x == y);
+		QB2(beq_v, V, x == y);
+		QB(beqz_i, I, x == 0);
+		QB(beqz_f, F, x == 0);
+		QB(beqz_v, V, x == 0.f);
+		QB2(bne_i, I, x != y);
+		QB2(bne_f, F, x != y);
+		QB2(bne_v, V, x != y);
+		QB2(blt_i, I, x < y);
+		QB2(blt_f, F, x < y);
+		QB2(bgt_i, I, x > y);
+		QB2(bgt_f, F, x > y);
+		QB2(ble_i, I, x <= y);
+		QB2(ble_f, F, x <= y);
+		QB2(bge_i, I, x >= y);
+		QB2(bge_f, F, x >= y);
+		// unchecked forms, for instructions the verifier proved can't fail (the branches are above)
+		I(j_u,
+			s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
+		);
+		I(call_u,
+			stack_push<false>(s, s->m_context.pc);
+			s->m_context.pc = HASL_CAST(size_t, a.ii) - 1;
+		);
+		I(ret_u,
+			s->m_context.pc = (stack_pop<size_t, false>(s));
+		);
+		I(psh_i_u,
+			stack_push<false>(s, RI(0));
+		);
+		I(psh_f_u,
+			stack_push<false>(s, RF(0));
+		);
+		I(psh_v_u,
+			stack_push<false>(s, RV(0));
+		);
+		I(pop_i_u,
+			RI(0) = (stack_pop<i_t, false>(s));
+		);
+		I(pop_f_u,
+			RF(0) = (stack_pop<f_t, false>(s));
+		);
+		I(pop_v_u,
+			RV(0) = (stack_pop<v_t, false>(s));
+		);
+		// the address is always the immediate
+		I(stm_i_u,
+			*((uint64_t*)(&m_memory[a.ii])) = *(uint64_t*)&RI(0);
+		);
+		I(stm_f_u,
+			*((uint64_t*)(&m_memory[a.ii])) = *(uint64_t*)&RF(0);
+		);
+		I(stm_v_u,
+			*((uint64_t*)(&m_memory[a.ii])) = *(uint64_t*)&RV(0);
+		);
+		I(ldm_u,
+			if (IS(1, I))
+				RI(1) = HASL_PUN(i_t, m_memory[a.ii]);
+			else if (IS(1, F))
+				RF(1) = HASL_PUN(f_t, m_memory[a.ii]);
+			else if (IS(1, V))
+				RV(1) = HASL_PUN(v_t, m_memory[a.ii]);
+		);
+		// superinstructions (each part runs with the program counter at its own instruction, so a part that aborts resumes at the next one)
+#define F2(p0, p1) \
+	I(p0##_##p1, \
+		p0(s, a, rt); \
+		if (s->m_context.abort) \
+			return; \
+		s->m_context.pc++; \
+		p1(s, (&a)[1], rt); \
+	)
+#define F3(p0, p1, p2) \
+	I(p0##_##p1##_##p2, \
+		p0(s, a, rt); \
+		if (s->m_context.abort) \
+			return; \
+		s->m_context.pc++; \
+		p1(s, (&a)[1], rt); \
+		if (s->m_context.abort) \
+			return; \
+		s->m_context.pc++; \
+		p2(s, (&a)[2], rt); \
+	)
+
+		// loop counters
+		F2(add_i, blt_i);
+		F2(add_i, bne_i);
+		F2(sub_i, bgt_i);
+		// load then operate
+		F2(mov_m, add_r);
+		F2(mov_i, add_r);
+		F2(mov_i, sub_r);
+		F2(movf_m, mulf_r);
+		F2(movf_f, addf_r);
+		F2(movf_f, mulf_r);
+		// position updates
+		F3(ogp, addv_v, osp);
+		F2(ogv, mulv_f);
+		F2(ogp, subv_v);
+		// subroutine arguments
+		F2(psh_i, psh_i);
+		F2(psh_i, call);
+		F2(psh_f, call);
+		F2(psh_v, call);
+		F2(pop_i, pop_i);
 
+#undef F3
+#undef F2
+#undef QB2
+#undef QB
+#undef QV
+#undef QFU
+#undef QF
+#undef QIU
+#undef QI
 #undef R
+#undef RV
+#undef RF
+#undef RI
 #undef I
 	private:
-		typedef void(vm::* operation)(script<STACK, RAM>* const, const args&, float, float, scriptable* const, std::vector<scriptable*>&);
-		static inline operation s_operations[c::max_op_count];
+		// picks the handler specialized for a's operand form, or the generic one if there isn't one
+		static uint16_t quicken(const args& a)
+		{
+			// register or immediate second operand
+#define QI(name) case op::name: return HASL_CAST(uint16_t, IS(1, I) ? op::name##_r : op::name##_i);
+#define QF(name) case op::name: return HASL_CAST(uint16_t, IS(1, F) ? op::name##_r : op::name##_i);
+			// register or immediate first operand
+#define QIU(name) case op::name: return HASL_CAST(uint16_t, IS(0, I) ? op::name##_r : op::name##_i);
+#define QFU(name) case op::name: return HASL_CAST(uint16_t, IS(0, F) ? op::name##_r : op::name##_i);
+			// vec, float, or immediate second operand
+#define QV(name) case op::name: return HASL_CAST(uint16_t, IS(1, V) ? op::name##_v : (IS(1, F) ? op::name##_f : op::name##_i));
+			// int, float, or vec register in slot n
+#define QR(name, n) case op::name: return HASL_CAST(uint16_t, IS(n, I) ? op::name##_i : (IS(n, F) ? op::name##_f : op::name##_v));
+			// both operands int, both float, or both vec (mixed comparisons stay generic)
+#define QB(name) case op::name: \
+	if (IS(0, I) && IS(1, I)) return HASL_CAST(uint16_t, op::name##_i); \
+	if (IS(0, F) && IS(1, F)) return HASL_CAST(uint16_t, op::name##_f); \
+	if (IS(0, V) && IS(1, V)) return HASL_CAST(uint16_t, op::name##_v); \
+	break;
+#define QBO(name) case op::name: \
+	if (IS(0, I) && IS(1, I)) return HASL_CAST(uint16_t, op::name##_i); \
+	if (IS(0, F) && IS(1, F)) return HASL_CAST(uint16_t, op::name##_f); \
+	break;
+
+			switch (HASL_CAST(op, a.opcode))
+			{
+				QI(add) QI(sub) QI(mul) QI(div)
+				QI(band) QI(bxor) QI(bor) QI(sl) QI(sr) QI(min) QI(max)
+				QIU(bnot) QIU(absolute) QIU(sign)
+				QF(addf) QF(subf) QF(mulf) QF(divf) QF(minf) QF(maxf) QF(power)
+				QFU(squareroot) QFU(absolutef) QFU(signf)
+				QV(addv) QV(subv) QV(mulv) QV(divv)
+				QR(psh, 0) QR(pop, 0) QR(stm, 0)
+				QB(beq) QB(bne) QBO(blt) QBO(bgt) QBO(ble) QBO(bge)
+			case op::beqz:
+				return HASL_CAST(uint16_t, IS(0, I) ? op::beqz_i : (IS(0, F) ? op::beqz_f : op::beqz_v));
+			case op::mov:
+				return HASL_CAST(uint16_t, IS(0, F) ? op::mov_f : (IS(0, I) ? op::mov_i : op::mov_m));
+			case op::movf:
+				return HASL_CAST(uint16_t, IS(0, F) ? op::movf_f : (IS(0, I) ? op::movf_i : op::movf_m));
+			case op::movv:
+				return HASL_CAST(uint16_t, IS(0, V) ? op::movv_v : (IS(0, I) ? op::movv_i : (IS(0, F) ? op::movv_f : op::movv_m)));
+			default:
+				break;
+			}
+			return a.opcode;
+
+#undef QBO
+#undef QB
+#undef QR
+#undef QV
+#undef QFU
+#undef QIU
+#undef QF
+#undef QI
+#undef IS
+		}
+		static bool is_fused(uint16_t handler)
+		{
+#define X(name) case op::name: return true;
+			switch (HASL_CAST(op, handler))
+			{
+				HASL_SASM_FUSED_HANDLERS(X)
+			default:
+				return false;
+			}
+#undef X
+		}
+		// runs s from its program counter until it aborts, falls off the end of its instructions, or has dispatched `budget` of them (a
+		// superinstruction counts once). returns what's left of the budget (which is only counted down if BUDGETED)
+		template<bool BUDGETED>
+		int64_t execute(script<STACK, RAM>& s, script_runtime& rt, int64_t budget)
+		{
+			const args* const code = s.m_instructions.data();
+			const size_t count = s.m_instructions.size();
+			if (s.m_context.abort || s.m_context.pc >= count || budget <= 0)
+				return budget;
+
+#if HASL_COMPUTED_GOTO
+			// direct threading: each handler is a label in this function and jumps straight to the next instruction's handler
+#define X(name) &&op_##name,
+#define U(name) &&op_##name##_u,
+			static void* const labels[] = { HASL_SASM_HANDLERS(X) HASL_SASM_QUICK_HANDLERS(X) HASL_SASM_FUSED_HANDLERS(X) HASL_SASM_UNCHECKED_HANDLERS(U) };
+#undef U
+#undef X
+#define X(name) \
+	op_##name: \
+		name(&s, code[s.m_context.pc], rt); \
+		s.m_context.pc++; \
+		if ((BUDGETED && --budget == 0) || s.m_context.pc >= count || s.m_context.abort) \
+			return budget; \
+		goto *labels[code[s.m_context.pc].handler];
+
+#define U(name) X(name##_u)
+
+			goto *labels[code[s.m_context.pc].handler];
+			HASL_SASM_HANDLERS(X)
+			HASL_SASM_QUICK_HANDLERS(X)
+			HASL_SASM_FUSED_HANDLERS(X)
+			HASL_SASM_UNCHECKED_HANDLERS(U)
+#undef U
+#undef X
+#else
+			// portable fallback
+			bool more = true;
+			while (more && budget > 0)
+			{
+				more = step(s, rt);
+				budget--;
+			}
+			return budget;
+#endif
+		}
+		// like execute, but one instruction at a time, with superinstructions run as their parts, and each one counted by the profiler
+		int64_t profile(script<STACK, RAM>& s, script_runtime& rt, int64_t budget, bool resumed)
+		{
+			typename profiler<STACK, RAM>::run r = m_profiler->begin(s, resumed);
+			const auto start = std::chrono::steady_clock::now();
+
+			const std::span<const args> code = s.m_instructions;
+			context<STACK>& ctx = s.m_context;
+			bool more = !ctx.abort && ctx.pc < code.size();
+			while (more && budget > 0)
+			{
+				const args& a = code[ctx.pc];
+				r.count(ctx.pc);
+				more = step(s, rt, is_fused(a.handler) ? quicken(a) : a.handler);
+				budget--;
+				// follow calls and returns that happened, to know which subroutine each instruction ran in
+				if (ctx.abort)
+					continue;
+				if (a.opcode == HASL_CAST(uint16_t, op::call))
+					r.enter(HASL_CAST(size_t, a.ii));
+				else if (a.opcode == HASL_CAST(uint16_t, op::ret))
+					r.leave();
+			}
+
+			r.rec->seconds += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+			return budget;
+		}
+		// runs the instruction at the program counter, returns whether the script should keep going
+		bool step(script<STACK, RAM>& s, script_runtime& rt)
+		{
+			return step(s, rt, s.m_instructions[s.m_context.pc].handler);
+		}
+		// same, with the given handler instead of the instruction's own
+		bool step(script<STACK, RAM>& s, script_runtime& rt, uint16_t handler)
+		{
+			const args& cur = s.m_instructions[s.m_context.pc];
+#define X(name) case op::name: name(&s, cur, rt); break;
+#define U(name) X(name##_u)
+			switch (HASL_CAST(op, handler))
+			{
+				HASL_SASM_HANDLERS(X)
+				HASL_SASM_QUICK_HANDLERS(X)
+				HASL_SASM_FUSED_HANDLERS(X)
+				HASL_SASM_UNCHECKED_HANDLERS(U)
+			default:
+				break;
+			}
+#undef U
+#undef X
+			return ++s.m_context.pc < s.m_instructions.size() && !s.m_context.abort;
+		}
+	private:
+		typedef void(vm::* operation)(script<STACK, RAM>* const, const args&, script_runtime&);
+		// opcode of each handler
+		enum class op : uint16_t
+		{
+#define X(name) name,
+#define U(name) name##_u,
+			HASL_SASM_HANDLERS(X)
+			HASL_SASM_QUICK_HANDLERS(X)
+			HASL_SASM_FUSED_HANDLERS(X)
+			HASL_SASM_UNCHECKED_HANDLERS(U)
+#undef U
+#undef X
+			count
+		};
+		// sequences of handlers that vm::fuse replaces with a superinstruction (only the last part may transfer control)
+		struct fusion
+		{
+			std::vector<op> parts;
+			op fused;
+		};
+		const static inline std::vector<fusion> s_fusions =
+		{
+			// longest first, so a three part sequence isn't split up by a two part one
+			{ { op::ogp, op::addv_v, op::osp }, op::ogp_addv_v_osp },
+			{ { op::add_i, op::blt_i }, op::add_i_blt_i },
+			{ { op::add_i, op::bne_i }, op::add_i_bne_i },
+			{ { op::sub_i, op::bgt_i }, op::sub_i_bgt_i },
+			{ { op::mov_m, op::add_r }, op::mov_m_add_r },
+			{ { op::mov_i, op::add_r }, op::mov_i_add_r },
+			{ { op::mov_i, op::sub_r }, op::mov_i_sub_r },
+			{ { op::movf_m, op::mulf_r }, op::movf_m_mulf_r },
+			{ { op::movf_f, op::addf_r }, op::movf_f_addf_r },
+			{ { op::movf_f, op::mulf_r }, op::movf_f_mulf_r },
+			{ { op::ogv, op::mulv_f }, op::ogv_mulv_f },
+			{ { op::ogp, op::subv_v }, op::ogp_subv_v },
+			{ { op::psh_i, op::psh_i }, op::psh_i_psh_i },
+			{ { op::psh_i, op::call }, op::psh_i_call },
+			{ { op::psh_f, op::call }, op::psh_f_call },
+			{ { op::psh_v, op::call }, op::psh_v_call },
+			{ { op::pop_i, op::pop_i }, op::pop_i_pop_i }
+		};
+		// name of each handler
+#define X(name) #name,
+#define U(name) #name "_u",
+		constexpr static const char* s_handler_names[] =
+		{
+			HASL_SASM_HANDLERS(X) HASL_SASM_QUICK_HANDLERS(X) HASL_SASM_FUSED_HANDLERS(X) HASL_SASM_UNCHECKED_HANDLERS(U)
+		};
+#undef U
+#undef X
+		// number of handlers that are opcodes (the rest are quickened forms)
+#define X(name) + 1
+		constexpr static size_t s_opcode_count = 0 HASL_SASM_HANDLERS(X);
+#undef X
 		static inline std::unordered_map<size_t, std::string> s_command_names;
-		static inline std::unordered_map<std::string, command_description> s_command_descriptions;
+		static inline string_map<command_description> s_command_descriptions;
 
 
 		struct instruction
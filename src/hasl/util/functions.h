@@ -3,42 +3,35 @@
 
 namespace hasl
 {
-	static std::string string_trim(const std::string& s)
+	// hashes std::string keys and std::string_views alike, so a map keyed by std::string (see string_map) can be searched with a view
+	// without making a string from it
+	struct string_hash
 	{
-		const size_t start = s.find_first_not_of(c::whitespace_tokens);
-		const size_t end = s.find_last_not_of(c::whitespace_tokens);
-		if (start == std::string::npos || end == std::string::npos)
-			return "";
-		return s.substr(start, end - start + 1);
-	}
-	static std::vector<std::string> string_split(const std::string& s, char delim)
-	{
-		std::vector<std::string> result;
-		std::string cur;
-		size_t last = 0;
-		bool in_string = false;
+		using is_transparent = void;
 
-		for (size_t i = 0; i < s.size(); i++)
+		size_t operator()(std::string_view s) const
 		{
-			if (s[i] == c::string_token)
-				in_string = !in_string;
-			if (!in_string && s[i] == delim)
-			{
-				result.emplace_back(string_trim(s.substr(last, i - last)));
-				last = i + 1;
-			}
+			return std::hash<std::string_view>()(s);
 		}
-		// end of the string may not have a delimiter, but should still be added
-		result.emplace_back(string_trim(s.substr(last)));
-
-		return result;
+	};
+	template<typename T>
+	using string_map = std::unordered_map<std::string, T, string_hash, std::equal_to<>>;
+	// where 64-bit FNV-1a starts
+	constexpr static uint64_t fnv1a_basis = 0xcbf29ce484222325;
+	// 64-bit FNV-1a of size bytes at data, carrying on from h (pass the last result to hash several things in a row)
+	static uint64_t fnv1a(const void* data, size_t size, uint64_t h = fnv1a_basis)
+	{
+		const uint8_t* const bytes = HASL_CAST(const uint8_t*, data);
+		for (size_t i = 0; i < size; i++)
+			h = (h ^ bytes[i]) * 0x100000001b3;
+		return h;
 	}
-	static size_t string_next_space(const std::string& s)
+	// fnv1a of word's bytes, least significant first on any machine
+	static uint64_t fnv1a(uint64_t word, uint64_t h)
 	{
-		size_t space = s.find_first_of(hasl::c::whitespace_tokens);
-		if (space == std::string::npos)
-			space = s.size();
-		return space;
+		if constexpr (std::endian::native == std::endian::big)
+			word = std::byteswap(word);
+		return fnv1a(&word, sizeof(word), h);
 	}
 	template<typename T>
 	static int sign(const T& t)
@@ -53,7 +46,7 @@ namespace hasl
 		char* buffer = new char[bufferLength];
 		for (size_t i = 0; i < count; i++)
 		{
-			sprintf_s(buffer, bufferLength, "%s%s", fmt.c_str(), (i != count - 1 ? sep.c_str() : ""));
+			snprintf(buffer, bufferLength, "%s%s", fmt.c_str(), (i != count - 1 ? sep.c_str() : ""));
 			printf(buffer, arr[i]);
 			if (i != 0 && (i + 1) % wrap == 0)
 				printf("\n\t");
@@ -81,27 +74,4 @@ namespace hasl
 	{
 		std::this_thread::sleep_for(std::chrono::milliseconds(ms));
 	}
-	static void write_ulong(std::ofstream& out, uint64_t i)
-	{
-		out.put(HASL_CAST(char, (i & 0xff00000000000000) >> 56));
-		out.put(HASL_CAST(char, (i & 0xff000000000000) >> 48));
-		out.put(HASL_CAST(char, (i & 0xff0000000000) >> 40));
-		out.put(HASL_CAST(char, (i & 0xff00000000) >> 32));
-		out.put(HASL_CAST(char, (i & 0xff000000) >> 24));
-		out.put(HASL_CAST(char, (i & 0xff0000) >> 16));
-		out.put(HASL_CAST(char, (i & 0xff00) >> 8));
-		out.put(HASL_CAST(char, (i & 0xff) >> 0));
-	}
-	static uint64_t read_ulong(std::ifstream& in)
-	{
-		return
-			(HASL_CAST(uint64_t, in.get()) << 56) |
-			(HASL_CAST(uint64_t, in.get()) << 48) |
-			(HASL_CAST(uint64_t, in.get()) << 40) |
-			(HASL_CAST(uint64_t, in.get()) << 32) |
-			(HASL_CAST(uint64_t, in.get()) << 24) |
-			(HASL_CAST(uint64_t, in.get()) << 16) |
-			(HASL_CAST(uint64_t, in.get()) << 8) |
-			(HASL_CAST(uint64_t, in.get()) << 0);
-	}
 }
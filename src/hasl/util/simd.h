@@ -0,0 +1,155 @@
+#pragma once
+#include "pch.h"
+
+namespace hasl::simd
+{
+	// a pair of floats, kept in the low half of a vector register with HASL_SIMD (so loading or storing one is a single 64 bit move). every
+	// operation is done per lane with correctly rounded instructions, in the same order as the scalar fallback, so the results match it
+	// bit for bit (except for rsqrt, which is only used outside HASL_STRICT_FP)
+#if HASL_SIMD && (defined(__aarch64__) || defined(_M_ARM64))
+	typedef float32x2_t f2;
+
+	HASL_INLINE f2 load(const float* p)
+	{
+		return vld1_f32(p);
+	}
+	HASL_INLINE void store(float* p, f2 a)
+	{
+		vst1_f32(p, a);
+	}
+	HASL_INLINE f2 splat(float t)
+	{
+		return vdup_n_f32(t);
+	}
+	HASL_INLINE f2 add(f2 a, f2 b)
+	{
+		return vadd_f32(a, b);
+	}
+	HASL_INLINE f2 sub(f2 a, f2 b)
+	{
+		return vsub_f32(a, b);
+	}
+	HASL_INLINE f2 mul(f2 a, f2 b)
+	{
+		return vmul_f32(a, b);
+	}
+	HASL_INLINE f2 div(f2 a, f2 b)
+	{
+		return vdiv_f32(a, b);
+	}
+	HASL_INLINE f2 abs(f2 a)
+	{
+		return vabs_f32(a);
+	}
+	// x + y
+	HASL_INLINE float sum(f2 a)
+	{
+		return vget_lane_f32(vpadd_f32(a, a), 0);
+	}
+	// estimate refined with one newton step (about 23 bits), faster than a square root and a divide but not bitwise portable
+	HASL_INLINE float rsqrt(float t)
+	{
+		const float32x2_t v = vdup_n_f32(t);
+		float32x2_t r = vrsqrte_f32(v);
+		r = vmul_f32(r, vrsqrts_f32(vmul_f32(v, r), r));
+		return vget_lane_f32(r, 0);
+	}
+#elif HASL_SIMD
+	typedef __m128 f2;
+
+	HASL_INLINE f2 load(const float* p)
+	{
+		return _mm_castpd_ps(_mm_load_sd(reinterpret_cast<const double*>(p)));
+	}
+	HASL_INLINE void store(float* p, f2 a)
+	{
+		_mm_store_sd(reinterpret_cast<double*>(p), _mm_castps_pd(a));
+	}
+	HASL_INLINE f2 splat(float t)
+	{
+		return _mm_set1_ps(t);
+	}
+	HASL_INLINE f2 add(f2 a, f2 b)
+	{
+		return _mm_add_ps(a, b);
+	}
+	HASL_INLINE f2 sub(f2 a, f2 b)
+	{
+		return _mm_sub_ps(a, b);
+	}
+	HASL_INLINE f2 mul(f2 a, f2 b)
+	{
+		return _mm_mul_ps(a, b);
+	}
+	HASL_INLINE f2 div(f2 a, f2 b)
+	{
+		// the upper lanes of b are zero after a load, so they're set to 1 to keep 0 / 0 from raising the invalid flag
+		return _mm_div_ps(a, _mm_movelh_ps(b, _mm_set1_ps(1.f)));
+	}
+	HASL_INLINE f2 abs(f2 a)
+	{
+		return _mm_andnot_ps(_mm_set1_ps(-0.f), a);
+	}
+	// x + y
+	HASL_INLINE float sum(f2 a)
+	{
+		return _mm_cvtss_f32(_mm_add_ss(a, _mm_shuffle_ps(a, a, _MM_SHUFFLE(1, 1, 1, 1))));
+	}
+	// estimate refined with one newton step (about 23 bits), faster than a square root and a divide but not bitwise portable
+	HASL_INLINE float rsqrt(float t)
+	{
+		const __m128 v = _mm_set_ss(t);
+		const __m128 r = _mm_rsqrt_ss(v);
+		const __m128 rr = _mm_mul_ss(_mm_mul_ss(v, r), r);
+		return _mm_cvtss_f32(_mm_mul_ss(_mm_mul_ss(_mm_set_ss(.5f), r), _mm_sub_ss(_mm_set_ss(3.f), rr)));
+	}
+#else
+	struct f2
+	{
+		float x, y;
+	};
+
+	inline f2 load(const float* p)
+	{
+		return { p[0], p[1] };
+	}
+	inline void store(float* p, f2 a)
+	{
+		p[0] = a.x;
+		p[1] = a.y;
+	}
+	inline f2 splat(float t)
+	{
+		return { t, t };
+	}
+	inline f2 add(f2 a, f2 b)
+	{
+		return { a.x + b.x, a.y + b.y };
+	}
+	inline f2 sub(f2 a, f2 b)
+	{
+		return { a.x - b.x, a.y - b.y };
+	}
+	inline f2 mul(f2 a, f2 b)
+	{
+		return { a.x * b.x, a.y * b.y };
+	}
+	inline f2 div(f2 a, f2 b)
+	{
+		return { a.x / b.x, a.y / b.y };
+	}
+	inline f2 abs(f2 a)
+	{
+		return { std::abs(a.x), std::abs(a.y) };
+	}
+	// x + y
+	inline float sum(f2 a)
+	{
+		return a.x + a.y;
+	}
+	inline float rsqrt(float t)
+	{
+		return 1.f / std::sqrt(t);
+	}
+#endif
+}
@@ -1,13 +1,17 @@
 #pragma once
 #include "pch.h"
 #include "functions.h"
+#include "simd.h"
 #include "hasl/core.h"
 
 namespace hasl
 {
+	// vec<float> does its arithmetic two lanes at a time through simd::f2 (see simd.h). it's trivially copyable and aligned to its size,
+	// so copies are a single move and arrays of them can be vectorized by the compiler
 	template<typename T>
-	struct vec
+	struct alignas(2 * sizeof(T)) vec
 	{
+		constexpr static bool packed = std::is_same_v<T, float>;
 		T x, y;
 
 
@@ -15,16 +19,8 @@ namespace hasl
 		template<typename U>
 		vec(const U& u) : x(HASL_CAST(T, u)), y(HASL_CAST(T, u)) {}
 		vec(const T& _x, const T& _y) : x(_x), y(_y) {}
-		// copy constructor
-		vec(const vec<T>& other)
-		{
-			operator=(other);
-		}
-		// move constructor (compiler wants "noexcept" even though it's irrelevant to us)
-		vec(vec<T>&& other) noexcept
-		{
-			operator=(other);
-		}
+		vec(const vec<T>& other) = default;
+		vec(vec<T>&& other) noexcept = default;
 
 
 		bool operator==(const T& t) const
@@ -41,26 +37,27 @@ namespace hasl
 		{
 			return x != other.x || y != other.y;
 		}
-		// copy values from other into this
-		vec<T>& operator=(const vec<T>& other)
-		{
-			x = other.x;
-			y = other.y;
-			return *this;
-		}
+		vec<T>& operator=(const vec<T>& other) = default;
+		vec<T>& operator=(vec<T>&& other) noexcept = default;
 		// return new vector with both of this vector's fields PLUS t
 		vec<T> operator+(const T& t) const
 		{
+			if constexpr (packed)
+				return unpack(simd::add(pack(), simd::splat(t)));
 			return { x + t, y + t };
 		}
 		// return new vector with this vector's fields PLUS other's fields
 		vec<T> operator+(const vec<T>& other) const
 		{
+			if constexpr (packed)
+				return unpack(simd::add(pack(), other.pack()));
 			return { x + other.x, y + other.y };
 		}
 		// add t to both of this vector's fields
 		vec<T>& operator+=(const T& t)
 		{
+			if constexpr (packed)
+				return *this = operator+(t);
 			x += t;
 			y += t;
 			return *this;
@@ -68,6 +65,8 @@ namespace hasl
 		// add other's fields to this vector's fields
 		vec<T>& operator+=(const vec<T>& other)
 		{
+			if constexpr (packed)
+				return *this = operator+(other);
 			x += other.x;
 			y += other.y;
 			return *this;
@@ -79,16 +78,22 @@ namespace hasl
 		// return new vector with both of this vector's fields MINUS t
 		vec<T> operator-(const T& t) const
 		{
+			if constexpr (packed)
+				return unpack(simd::sub(pack(), simd::splat(t)));
 			return { x - t, y - t };
 		}
 		// return new vector with this vector's fields MINUS other's fields
 		vec<T> operator-(const vec<T>& other) const
 		{
+			if constexpr (packed)
+				return unpack(simd::sub(pack(), other.pack()));
 			return { x - other.x, y - other.y };
 		}
 		// subtract t from both of this vector's fields
 		vec<T>& operator-=(const T& t)
 		{
+			if constexpr (packed)
+				return *this = operator-(t);
 			x -= t;
 			y -= t;
 			return *this;
@@ -96,6 +101,8 @@ namespace hasl
 		// subtract other's fields from this vector's fields
 		vec<T>& operator-=(const vec<T>& other)
 		{
+			if constexpr (packed)
+				return *this = operator-(other);
 			x -= other.x;
 			y -= other.y;
 			return *this;
@@ -103,16 +110,22 @@ namespace hasl
 		// return new vector with both of this vector's fields TIMES t
 		vec<T> operator*(const T& t) const
 		{
+			if constexpr (packed)
+				return unpack(simd::mul(pack(), simd::splat(t)));
 			return { x * t, y * t };
 		}
 		// return new vector with this vector's fields TIMES other's fields
 		vec<T> operator*(const vec<T>& other) const
 		{
+			if constexpr (packed)
+				return unpack(simd::mul(pack(), other.pack()));
 			return { x * other.x, y * other.y };
 		}
 		// MULTIPLY this vector's fields by t
 		vec<T>& operator*=(const T& t)
 		{
+			if constexpr (packed)
+				return *this = operator*(t);
 			x *= t;
 			y *= t;
 			return *this;
@@ -120,6 +133,8 @@ namespace hasl
 		// MULTIPLY this vector's fields by other's fields
 		vec<T>& operator*=(const vec<T>& other)
 		{
+			if constexpr (packed)
+				return *this = operator*(other);
 			x *= other.x;
 			y *= other.y;
 			return *this;
@@ -127,16 +142,22 @@ namespace hasl
 		// return new vector with both of this vector's fields DIVIDED BY t
 		vec<T> operator/(const T& t) const
 		{
+			if constexpr (packed)
+				return unpack(simd::div(pack(), simd::splat(t)));
 			return { x / t, y / t };
 		}
 		// return new vector with this vector's fields DIVIDED BY other's fields
 		vec<T> operator/(const vec<T>& other) const
 		{
+			if constexpr (packed)
+				return unpack(simd::div(pack(), other.pack()));
 			return { x / other.x, y / other.y };
 		}
 		// DIVIDE this vector's fields by t
 		vec<T>& operator/=(const T& t)
 		{
+			if constexpr (packed)
+				return *this = operator/(t);
 			x /= t;
 			y /= t;
 			return *this;
@@ -144,6 +165,8 @@ namespace hasl
 		// DIVIDE this vector's fields by other's fields
 		vec<T>& operator/=(const vec<T>& other)
 		{
+			if constexpr (packed)
+				return *this = operator/(other);
 			x /= other.x;
 			y /= other.y;
 			return *this;
@@ -151,21 +174,27 @@ namespace hasl
 		// the length of this vector
 		T magnitude() const
 		{
-			return HASL_CAST(T, std::sqrt(x * x + y * y));
+			return HASL_CAST(T, std::sqrt(dot(*this)));
 		}
 		// return a new vector that is this vector normalized
 		vec<T> normalized() const
 		{
+#if !HASL_STRICT_FP
+			if constexpr (packed)
+				return operator*(simd::rsqrt(dot(*this)));
+#endif
 			return operator/(magnitude());
 		}
 		// normalize this vector and return it
 		vec<T>& normalize()
 		{
-			return operator/=(magnitude());
+			return *this = normalized();
 		}
 		// dot product of this vector and other
 		T dot(const vec<T>& other) const
 		{
+			if constexpr (packed)
+				return simd::sum(simd::mul(pack(), other.pack()));
 			return x * other.x + y * other.y;
 		}
 		// the angle (relative to the x-axis) of this vector
@@ -176,6 +205,10 @@ namespace hasl
 		// the angle between this vector and other
 		T angle_between(const vec<T>& other) const
 		{
+#if !HASL_STRICT_FP
+			if constexpr (packed)
+				return std::acos(dot(other) * simd::rsqrt(dot(*this) * other.dot(other)));
+#endif
 			return std::acos(dot(other) / (magnitude() * other.magnitude()));
 		}
 		vec<T>& clamp(const T& lo, const T& hi)
@@ -193,8 +226,21 @@ namespace hasl
 		}
 		vec<T> abs() const
 		{
+			if constexpr (packed)
+				return unpack(simd::abs(pack()));
 			return { std::abs(x), std::abs(y) };
 		}
+	private:
+		simd::f2 pack() const
+		{
+			return simd::load(&x);
+		}
+		static vec<T> unpack(simd::f2 a)
+		{
+			vec<T> v;
+			simd::store(&v.x, a);
+			return v;
+		}
 	};
 
 
@@ -1,13 +1,42 @@
 #pragma once
+#include <cstdio>
+#include <cstdint>
+#include <cmath>
+#include <csignal>
 #include <vector>
 #include <string>
+#include <string_view>
+#include <charconv>
 #include <unordered_map>
+#include <unordered_set>
+#include <map>
 #include <fstream>
+#include <sstream>
+#include <filesystem>
 #include <numbers>
 #include <thread>
 #include <functional>
+#include <memory>
+#include <limits>
+#include <type_traits>
+#include <cstring>
+#include <deque>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <algorithm>
+#include <chrono>
+#include <span>
+#include <bit>
 
 #include "hasl/core.h"
+#if HASL_SIMD
+#if defined(__aarch64__) || defined(_M_ARM64)
+#include <arm_neon.h>
+#else
+#include <emmintrin.h>
+#endif
+#endif
 
 #include "hasl/constants.h"
 #include "hasl/sasm/constants.h"
@@ -0,0 +1,194 @@
+#include "pch.h"
+#include "hasl.h"
+#include <filesystem>
+#include <set>
+
+// Assembles trees of scripts to serialized bytecode (see script::serialize) on a pool of threads, without a vm. a script is only assembled
+// again if it's newer than its output, or the output was written by a build with another instruction set, STACK or RAM (see
+// bytecode_header), so a content pipeline can run this on every build.
+// usage: haslc [-h] [-o <output directory>] [-j <threads>] [-f] <.sasm file or directory>...
+// a/b.sasm in a directory given is written to <output directory>/a/b.sbc (next to its source without -o), and -f builds everything. prints
+// how long each script took. the game loads the output with deserialize, so build this with the game's STACK and RAM (HASLC_STACK and
+// HASLC_RAM) or every script will be decoded again when it's loaded.
+
+#ifndef HASLC_STACK
+#define HASLC_STACK 256
+#endif
+#ifndef HASLC_RAM
+#define HASLC_RAM 4096
+#endif
+
+namespace
+{
+	using vm_t = hasl::sasm::vm<HASLC_STACK, HASLC_RAM>;
+	using script_t = hasl::sasm::script<HASLC_STACK, HASLC_RAM>;
+	using hasl::sasm::bytecode_header;
+	using clock = std::chrono::steady_clock;
+
+	struct options
+	{
+		std::filesystem::path output;
+		size_t threads = 0;
+		bool force = false;
+	};
+	// one script to build
+	struct unit
+	{
+		std::filesystem::path source, output;
+	};
+	enum class status
+	{
+		UP_TO_DATE, BUILT, FAILED
+	};
+
+	void collect(const std::filesystem::path& path, const options& o, std::vector<unit>* const units)
+	{
+		auto output = [&](const std::filesystem::path& source, const std::filesystem::path& relative)
+		{
+			std::filesystem::path out = o.output.empty() ? source : o.output / relative;
+			return out.replace_extension(".sbc");
+		};
+		if (std::filesystem::is_directory(path))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+				if (entry.is_regular_file() && entry.path().extension() == ".sasm")
+					units->push_back({ entry.path(), output(entry.path(), std::filesystem::relative(entry.path(), path)) });
+		}
+		else
+			units->push_back({ path, output(path, path.filename()) });
+	}
+	// the files a script's bytecode is built from (scripts can't include others, so just its source)
+	std::vector<std::filesystem::path> dependencies(const unit& u)
+	{
+		return { u.source };
+	}
+	// whether u's output is newer than everything it's built from, and was written for this instruction set, STACK and RAM
+	bool up_to_date(const unit& u)
+	{
+		std::error_code error;
+		const auto built = std::filesystem::last_write_time(u.output, error);
+		if (error)
+			return false;
+		for (const std::filesystem::path& dependency : dependencies(u))
+		{
+			const auto changed = std::filesystem::last_write_time(dependency, error);
+			if (error || changed > built)
+				return false;
+		}
+
+		bytecode_header h;
+		std::ifstream in(u.output, std::ios::binary);
+		if (!in.read(reinterpret_cast<char*>(&h), sizeof(h)))
+			return false;
+		return memcmp(h.magic, bytecode_header::s_magic, sizeof(h.magic)) == 0 && h.version == bytecode_header::s_version &&
+			h.endian == bytecode_header::s_endian && h.fingerprint == vm_t::handler_fingerprint() && h.stack == HASLC_STACK &&
+			h.ram == HASLC_RAM;
+	}
+	status build(const unit& u)
+	{
+		const script_t s(u.source.string().c_str(), nullptr);
+		if (!s.is_assembled())
+			return status::FAILED;
+
+		// written next to it and renamed, so an output that's there is always whole
+		std::error_code error;
+		std::filesystem::create_directories(u.output.parent_path(), error);
+		std::filesystem::path temporary = u.output;
+		temporary += ".tmp";
+		std::ofstream out(temporary, std::ios::binary);
+		if (!out.is_open())
+		{
+			printf("Error opening '%s' for writing\n", temporary.string().c_str());
+			return status::FAILED;
+		}
+		s.serialize(out);
+		out.close();
+		if (out.fail())
+			printf("Error writing '%s'\n", temporary.string().c_str());
+		else
+		{
+			std::filesystem::rename(temporary, u.output, error);
+			if (!error)
+				return status::BUILT;
+			printf("Error writing '%s'\n", u.output.string().c_str());
+		}
+		// a partial one isn't left behind
+		std::filesystem::remove(temporary, error);
+		return status::FAILED;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	const char* const usage = "usage: haslc [-h] [-o <output directory>] [-j <threads>] [-f] <.sasm file or directory>...\n";
+	options o;
+	std::vector<std::filesystem::path> inputs;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+			o.output = argv[++i];
+		else if (arg == "-j" && i + 1 < argc)
+			o.threads = std::stoul(argv[++i]);
+		else if (arg == "-f")
+			o.force = true;
+		else if (arg == "-h" || arg == "--help")
+		{
+			printf("%s", usage);
+			return 0;
+		}
+		else
+			inputs.push_back(arg);
+	}
+	if (inputs.empty())
+	{
+		printf("%s", usage);
+		return 1;
+	}
+
+	std::vector<unit> units;
+	for (const std::filesystem::path& input : inputs)
+	{
+		if (!std::filesystem::exists(input))
+		{
+			printf("No such file or directory '%s'\n", input.string().c_str());
+			return 1;
+		}
+		collect(input, o, &units);
+	}
+	// two scripts written to the same place would race
+	std::set<std::filesystem::path> outputs;
+	for (const unit& u : units)
+	{
+		if (!outputs.insert(u.output).second)
+		{
+			printf("More than one script would be written to '%s'\n", u.output.string().c_str());
+			return 1;
+		}
+	}
+
+	hasl::sasm::executor pool(o.threads);
+	std::vector<status> results(units.size(), status::UP_TO_DATE);
+	const auto start = clock::now();
+	pool.run(units.size(), [&](size_t i)
+	{
+		const unit& u = units[i];
+		if (!o.force && up_to_date(u))
+			return;
+		const auto unit_start = clock::now();
+		results[i] = build(u);
+		const double ms = std::chrono::duration<double, std::milli>(clock::now() - unit_start).count();
+		if (results[i] == status::BUILT)
+			printf("%9.3f ms  %s\n", ms, u.source.string().c_str());
+		else
+			printf("   failed     %s\n", u.source.string().c_str());
+	});
+	const double ms = std::chrono::duration<double, std::milli>(clock::now() - start).count();
+
+	size_t counts[3] = { 0 };
+	for (const status s : results)
+		counts[HASL_CAST(size_t, s)]++;
+	printf("%zu built, %zu up to date, %zu failed in %.3f ms on %zu threads\n", counts[HASL_CAST(size_t, status::BUILT)],
+		counts[HASL_CAST(size_t, status::UP_TO_DATE)], counts[HASL_CAST(size_t, status::FAILED)], ms, pool.get_thread_count());
+	return counts[HASL_CAST(size_t, status::FAILED)] ? 1 : 0;
+}
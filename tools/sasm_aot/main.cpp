@@ -0,0 +1,237 @@
+#include "pch.h"
+#include "hasl.h"
+#include <filesystem>
+
+// Compiles scripts ahead of time to C++ (see hasl/sasm/aot.h). Each script becomes one function that runs against the vm's state: branches are
+// gotos and every other instruction calls its quickened handler with constant operands, so the compiler can inline and fold it.
+// usage: sasm_aot [-o <output.cpp>] <.sasm file, serialized script, or directory>...
+// scripts are hashed after assembly and string literals are placed at the top of RAM, so build this with the game's STACK and RAM
+// (SASM_AOT_STACK and SASM_AOT_RAM) or the compiled versions won't match the scripts the game loads.
+
+#ifndef SASM_AOT_STACK
+#define SASM_AOT_STACK 256
+#endif
+#ifndef SASM_AOT_RAM
+#define SASM_AOT_RAM 4096
+#endif
+
+namespace
+{
+	using vm_t = hasl::sasm::vm<SASM_AOT_STACK, SASM_AOT_RAM>;
+	using script_t = hasl::sasm::script<SASM_AOT_STACK, SASM_AOT_RAM>;
+	using aot_t = hasl::sasm::aot<SASM_AOT_STACK, SASM_AOT_RAM>;
+
+	// assembling needs a vm, but nothing here is ever run
+	class aot_vm : public vm_t
+	{
+	protected:
+		hasl::sasm::scriptable* spawn(const char* s) override
+		{
+			return nullptr;
+		}
+		void process_spawn_queue(hasl::sasm::script_runtime& rt) override {}
+		bool is_key_pressed(hasl::sasm::i_t key) const override
+		{
+			return false;
+		}
+		bool is_mouse_pressed(hasl::sasm::i_t button) const override
+		{
+			return false;
+		}
+		hasl::sasm::v_t get_mouse_pos() const override
+		{
+			return {};
+		}
+		hasl::sasm::v_t get_mouse_scroll() const override
+		{
+			return {};
+		}
+	};
+
+	void collect(const std::filesystem::path& path, std::vector<std::string>* const files)
+	{
+		if (std::filesystem::is_directory(path))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+				if (entry.is_regular_file() && entry.path().extension() == ".sasm")
+					files->push_back(entry.path().string());
+		}
+		else
+			files->push_back(path.string());
+	}
+
+	// comparison done by a quickened branch handler ("beq_i", "blt_f", ...), or nullptr if name isn't one
+	const char* branch_operator(const std::string& name, char* const file)
+	{
+		const static std::unordered_map<std::string, const char*> operators =
+		{
+			{ "beq", "==" }, { "beqz", "==" }, { "bne", "!=" }, { "blt", "<" }, { "bgt", ">" }, { "ble", "<=" }, { "bge", ">=" }
+		};
+		const size_t split = name.find('_');
+		if (split == std::string::npos || split + 2 != name.size())
+			return nullptr;
+		const auto& it = operators.find(name.substr(0, split));
+		if (it == operators.end())
+			return nullptr;
+		*file = name[split + 1];
+		return it->second;
+	}
+
+	// goto the instruction at target from the one at i, charging the budget if it's a loop
+	void emit_goto(FILE* const out, size_t i, hasl::sasm::i_t target, const char* indent)
+	{
+		if (HASL_CAST(size_t, target) > i)
+			fprintf(out, "%sgoto i%lld;\n", indent, HASL_CAST(long long, target));
+		else
+			fprintf(out, "%s{ if (aot_t::charge(f, %zu, %lld)) return; goto i%lld; }\n", indent, i - HASL_CAST(size_t, target) + 1,
+				HASL_CAST(long long, target), HASL_CAST(long long, target));
+	}
+
+	void emit_script(FILE* const out, const script_t& s, const std::string& path, size_t index)
+	{
+		// with superinstructions split back into their parts, which are compiled one by one
+		std::vector<hasl::sasm::args> code(s.get_instructions().begin(), s.get_instructions().end());
+		for (hasl::sasm::args& a : code)
+			a.handler = aot_t::handler(a);
+		const size_t count = code.size();
+
+		fprintf(out, "\t// %s\n", path.c_str());
+		fprintf(out, "\tvoid script_%zu(aot_t::frame& f)\n\t{\n", index);
+		// the operands, as constants
+		fprintf(out, "\t\tstatic const hasl::sasm::args code[] =\n\t\t{\n");
+		for (size_t i = 0; i < count; i++)
+		{
+			const hasl::sasm::args& a = code[i];
+			fprintf(out, "\t\t\t{ %u, %u, %u, { %u, %u, %u }, 0, { HASL_CAST(hasl::sasm::i_t, 0x%llxull) } }, // %zu: %s\n",
+				a.handler, a.opcode, a.types, a.r[0], a.r[1], a.r[2], HASL_PUN(unsigned long long, a.ii), i, vm_t::handler_name(a.handler));
+		}
+		fprintf(out, "\t\t};\n");
+		// branches read the registers directly
+		char file = 0;
+		for (const hasl::sasm::args& a : code)
+			if (branch_operator(vm_t::handler_name(vm_t::checked(a.handler)), &file))
+			{
+				fprintf(out, "\t\thasl::sasm::registers& r = *f.regs;\n");
+				break;
+			}
+
+		// entry (from vm::run, and after anything that moves the program counter somewhere only known at runtime)
+		fprintf(out, "\t\tsize_t pc = aot_t::pc(f);\n");
+		fprintf(out, "\tdispatch:\n\t\tswitch (pc)\n\t\t{\n");
+		for (size_t i = 0; i < count; i++)
+			fprintf(out, "\t\tcase %zu: goto i%zu;\n", i, i);
+		fprintf(out, "\t\tdefault: return;\n\t\t}\n");
+
+		for (size_t i = 0; i < count; i++)
+		{
+			const hasl::sasm::args& a = code[i];
+			const std::string name = vm_t::handler_name(a.handler);
+			// what it does (the handler may be a form of it without checks)
+			const std::string form = vm_t::handler_name(vm_t::checked(a.handler));
+			const bool in_range = a.ii >= 0 && HASL_CAST(size_t, a.ii) < count;
+
+			fprintf(out, "\ti%zu:\n", i);
+			const char* const cmp = branch_operator(form, &file);
+			if (cmp && in_range)
+			{
+				const char* const reg = (file == 'i' ? "r.i" : (file == 'f' ? "r.f" : "r.v"));
+				if (form.starts_with("beqz"))
+					fprintf(out, "\t\tif (%s[%u] == 0)", reg, a.r[0]);
+				else
+					fprintf(out, "\t\tif (%s[%u] %s %s[%u])", reg, a.r[0], cmp, reg, a.r[1]);
+				emit_goto(out, i, a.ii, " ");
+			}
+			else if (form == "j" && in_range)
+				emit_goto(out, i, a.ii, "\t\t");
+			else if (vm_t::can_abort(a))
+			{
+				// the handler may read the program counter (call), and stopping leaves it after the instruction that stopped
+				fprintf(out, "\t\taot_t::pc(f) = %zu;\n", i);
+				fprintf(out, "\t\taot_t::%s(f, code[%zu]);\n", name.c_str(), i);
+				fprintf(out, "\t\tif (aot_t::aborted(f)) { aot_t::pc(f)++; return; }\n");
+				if (form == "call" && in_range)
+					fprintf(out, "\t\tgoto i%lld;\n", HASL_CAST(long long, a.ii));
+				else if (vm_t::is_control(a))
+				{
+					fprintf(out, "\t\tpc = aot_t::pc(f) + 1;\n");
+					fprintf(out, "\t\tif (pc <= %zu && aot_t::charge(f, %zu - pc, pc)) return;\n", i, i + 1);
+					fprintf(out, "\t\tgoto dispatch;\n");
+				}
+			}
+			else
+				fprintf(out, "\t\taot_t::%s(f, code[%zu]);\n", name.c_str(), i);
+		}
+		fprintf(out, "\t\taot_t::pc(f) = %zu;\n", count);
+		fprintf(out, "\t}\n");
+		fprintf(out, "\tconst aot_t::registration s_script_%zu(0x%llxull, &script_%zu);\n", index, HASL_CAST(unsigned long long, aot_t::hash(*s.get_program())), index);
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::string output;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-o" && i + 1 < argc)
+			output = argv[++i];
+		else
+			collect(arg, &files);
+	}
+	if (files.empty())
+	{
+		printf("usage: sasm_aot [-o <output.cpp>] <.sasm file, serialized script, or directory>...\n");
+		return 1;
+	}
+
+	// generated into a temporary file and copied to the output once every script has compiled, so a failure leaves no partial source (and
+	// the errors the assembler prints to stdout don't end up in it)
+	FILE* const code = std::tmpfile();
+	if (!code)
+	{
+		fprintf(stderr, "Error creating a temporary file\n");
+		return 1;
+	}
+	fprintf(code, "// generated by sasm_aot, do not edit\n");
+	fprintf(code, "#include \"pch.h\"\n#include \"hasl.h\"\n\n");
+	fprintf(code, "namespace\n{\n\ttypedef hasl::sasm::aot<%d, %d> aot_t;\n\n", SASM_AOT_STACK, SASM_AOT_RAM);
+
+	aot_vm vm;
+	for (size_t i = 0; i < files.size(); i++)
+	{
+		const std::filesystem::path path = files[i];
+		std::unique_ptr<script_t> s;
+		if (path.extension() == ".sasm")
+			s = std::make_unique<script_t>(files[i].c_str(), &vm);
+		else
+			s.reset(hasl::sasm::deserialize<script_t>(files[i].c_str(), &vm));
+
+		if (!s || !s->get_instructions().size())
+		{
+			fprintf(stderr, "Error compiling '%s'\n", files[i].c_str());
+			fclose(code);
+			return 1;
+		}
+		emit_script(code, *s, files[i], i);
+		fprintf(code, "\n");
+	}
+	fprintf(code, "}\n");
+
+	FILE* const out = output.empty() ? stdout : fopen(output.c_str(), "w");
+	if (!out)
+	{
+		fprintf(stderr, "Error opening output file '%s'\n", output.c_str());
+		fclose(code);
+		return 1;
+	}
+	rewind(code);
+	char buffer[4096];
+	for (size_t read; (read = fread(buffer, 1, sizeof(buffer), code)) > 0;)
+		fwrite(buffer, 1, read, out);
+	fclose(code);
+
+	if (out != stdout)
+		fclose(out);
+	return 0;
+}
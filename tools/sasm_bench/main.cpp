@@ -0,0 +1,407 @@
+#include "pch.h"
+#include "hasl.h"
+#include <filesystem>
+
+// Microbenchmarks the vm: every instruction in each of its operand forms, what dispatching one costs, and how fast scripts are assembled and
+// deserialized.
+// usage: sasm_bench [-n <iterations>] [-r <repeats>] [-jit] [-o <results.json>] [<opcode>...]
+// each instruction runs `unroll` times per iteration of a loop, and the loop's own cost (timed with nothing in it) is taken off. every time
+// is the best of the repeats. the results are printed as a table, and written as JSON with -o, to compare across releases.
+
+namespace
+{
+	constexpr static size_t stack_size = 256, ram_size = 4096;
+	// copies of the instruction in each loop iteration
+	constexpr static size_t unroll = 16;
+	// lines in the script that's assembled and deserialized
+	constexpr static size_t load_lines = 100000;
+	using vm_t = hasl::sasm::vm<stack_size, ram_size>;
+	using script_t = hasl::sasm::script<stack_size, ram_size>;
+	using hasl::sasm::arg_type;
+	using clock = std::chrono::steady_clock;
+
+	// hooks do as little as they can, so what's timed is the vm
+	class bench_vm : public vm_t
+	{
+	public:
+		using vm_t::run;
+	protected:
+		hasl::sasm::scriptable* spawn(const char* s) override
+		{
+			return nullptr;
+		}
+		void process_spawn_queue(hasl::sasm::script_runtime& rt) override {}
+		bool is_key_pressed(hasl::sasm::i_t key) const override
+		{
+			return false;
+		}
+		bool is_mouse_pressed(hasl::sasm::i_t button) const override
+		{
+			return false;
+		}
+		hasl::sasm::v_t get_mouse_pos() const override
+		{
+			return {};
+		}
+		hasl::sasm::v_t get_mouse_scroll() const override
+		{
+			return {};
+		}
+	};
+	// the object scripts run on ($obj is the host)
+	class bench_obj : public hasl::sasm::scriptable
+	{
+	public:
+		bench_obj() :
+			scriptable({ { "idle", nullptr } }, "idle")
+		{}
+		hasl::sasm::v_t get_dims() const override
+		{
+			return { 1.f, 1.f };
+		}
+	};
+
+	struct options
+	{
+		size_t iterations = 20000, repeats = 5;
+		bool jit = false;
+		std::string output;
+		std::vector<std::string> opcodes;
+	};
+	// one instruction in one operand form
+	struct result
+	{
+		std::string opcode, code, handler;
+		// what ns is for: one "instruction", one "pair" (psh and the pop that undoes it, or call and ret), or a whole "run" (end and slp stop
+		// the script, so they're timed by running a script of just that instruction)
+		const char* per;
+		double ns;
+	};
+	struct results
+	{
+		double loop_ns = 0, dispatch_ns = 0, lines_per_s = 0, mb_per_s = 0;
+		std::vector<result> instructions;
+	};
+
+	// what can be written in a slot of type t, one operand per form. labels and strings are only written as such, since a number or register
+	// in their place would be taken as an instruction index or an address
+	std::vector<std::string> operands(arg_type t, size_t slot, const std::string& label)
+	{
+		if ((t & arg_type::L) != arg_type::NONE)
+			return { label };
+		if ((t & arg_type::MS) != arg_type::NONE)
+			return { "\"idle\"" };
+
+		// the setup code gives $i1-3 3, $f1-3 1.5, and $v1-3 <1.5, 1.5>, so nothing divides by zero or reads outside RAM
+		const std::string n = std::to_string(slot + 1);
+		std::vector<std::string> list;
+		if ((t & arg_type::I) != arg_type::NONE)
+			list.push_back("$i" + n);
+		if ((t & arg_type::F) != arg_type::NONE)
+			list.push_back("$f" + n);
+		if ((t & arg_type::V) != arg_type::NONE)
+			list.push_back("$v" + n);
+		if ((t & (arg_type::MI | arg_type::MIS)) != arg_type::NONE)
+			list.push_back("3");
+		if ((t & arg_type::MF) != arg_type::NONE)
+			list.push_back("1.5");
+		return list;
+	}
+	// every way to write the operands of an instruction with these slots
+	std::vector<std::string> forms(const std::vector<arg_type>& slots, const std::string& label)
+	{
+		std::vector<std::string> list = { "" };
+		for (size_t i = 0; i < slots.size(); i++)
+		{
+			std::vector<std::string> next;
+			for (const std::string& prefix : list)
+				for (const std::string& operand : operands(slots[i], i, label))
+					next.push_back(prefix + (i ? ", " : " ") + operand);
+			list.swap(next);
+		}
+		return list;
+	}
+	// replaces every `from` in s with `to`
+	std::string replace(std::string s, const std::string& from, const std::string& to)
+	{
+		for (size_t at = s.find(from); at != std::string::npos; at = s.find(from, at + to.size()))
+			s.replace(at, from.size(), to);
+		return s;
+	}
+	std::string escape(const std::string& s)
+	{
+		return replace(replace(s, "\\", "\\\\"), "\"", "\\\"");
+	}
+	void write_file(const std::filesystem::path& path, const std::string& text)
+	{
+		std::ofstream out(path, std::ios::binary);
+		out << text;
+	}
+
+	class bench
+	{
+	public:
+		bench(const options& o) :
+			m_options(o),
+			m_dir(std::filesystem::temp_directory_path() / "sasm_bench"),
+			m_rt{ 0.f, 0.f, &m_obj, {} }
+		{
+			std::filesystem::create_directories(m_dir);
+			if (o.jit)
+				m_vm.set_jit_threshold(1);
+		}
+		HASL_DCM(bench);
+	public:
+		results run()
+		{
+			results r;
+			const double calls = HASL_CAST(double, m_options.iterations * unroll);
+			// the loop alone, and the cheapest instruction there is (so almost all of its time is getting to it)
+			const double empty = time_loop("", "");
+			r.loop_ns = empty * 1e9 / m_options.iterations;
+			r.dispatch_ns = (time_loop("\tmov $i1, $i3\n", "") - empty) * 1e9 / calls;
+
+			std::vector<std::pair<std::string, hasl::sasm::command_description>> opcodes(vm_t::get_command_descriptions().begin(),
+				vm_t::get_command_descriptions().end());
+			std::sort(opcodes.begin(), opcodes.end(), [](const auto& a, const auto& b) { return a.second.opcode < b.second.opcode; });
+			for (const auto& [name, desc] : opcodes)
+			{
+				if (!m_options.opcodes.empty() && std::find(m_options.opcodes.begin(), m_options.opcodes.end(), name) == m_options.opcodes.end())
+					continue;
+				// these print, ret and pop are timed along with call and psh
+				if (name == "dbg" || name == "dbgf" || name == "dbgv" || name == "dbgs" || name == "ret" || name == "pop")
+					continue;
+
+				for (std::string operands : forms(desc.args, name == "call" ? "sub" : "next"))
+				{
+					// these wait that long, so they're given 0 ($i0 is left at 0)
+					if (name == "blk" || name == "slp")
+						operands = replace(replace(operands, "$i1", "$i0"), "3", "0");
+
+					result cur = { name, name + operands, "", "instruction", 0 };
+					std::string body = "\t" + cur.code + "\n";
+					if (name == "psh")
+					{
+						body += "\tpop" + operands + "\n";
+						cur.code += " + pop" + operands;
+						cur.per = "pair";
+					}
+					else if (name == "call")
+					{
+						cur.code += " + ret";
+						cur.per = "pair";
+					}
+
+					if (name == "end" || name == "slp")
+					{
+						cur.per = "run";
+						cur.ns = time_runs("main:\n" + body, &cur.handler);
+					}
+					else
+						cur.ns = (time_loop(body, "sub:\n\tret\n", &cur.handler) - empty) * 1e9 / calls;
+					r.instructions.push_back(cur);
+				}
+			}
+
+			time_load(&r);
+			return r;
+		}
+	private:
+		options m_options;
+		std::filesystem::path m_dir;
+		bench_vm m_vm;
+		bench_obj m_obj;
+		hasl::sasm::script_runtime m_rt;
+	private:
+		// seconds for the best run of a script that runs body `unroll` times per iteration (each copy's "next" is the line after it), with
+		// tail after its end. the handler the first copy was given is written to handler
+		double time_loop(const std::string& body, const std::string& tail, std::string* const handler = nullptr)
+		{
+			std::string code =
+				"main:\n"
+				"\tmov -1, $obj\n"
+				"\tmov 3, $i1\n\tmov 3, $i2\n\tmov 3, $i3\n"
+				"\tmovf 1.5, $f1\n\tmovf 1.5, $f2\n\tmovf 1.5, $f3\n"
+				"\tmovv 1.5, $v1\n\tmovv 1.5, $v2\n\tmovv 1.5, $v3\n"
+				"\tmov 0, $k0\n"
+				"\tmov " + std::to_string(m_options.iterations) + ", $k1\n"
+				"loop:\n";
+			for (size_t i = 0; i < unroll; i++)
+				code += replace(body, "next", "next" + std::to_string(i)) + "next" + std::to_string(i) + ":\n";
+			code +=
+				"\tadd $k0, 1, $k0\n"
+				"\tblt $k0, $k1, loop\n"
+				"\tend\n" + tail;
+
+			const std::filesystem::path path = m_dir / "loop.sasm";
+			write_file(path, code);
+			script_t s(path.string().c_str(), &m_vm);
+			if (handler)
+				*handler = handler_at(s, "loop");
+
+			double best = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < m_options.repeats; i++)
+			{
+				const auto start = clock::now();
+				m_vm.run(s, m_rt);
+				best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+				m_rt.env.clear();
+			}
+			return best;
+		}
+		// nanoseconds for the best run of code, which is run `iterations` times
+		double time_runs(const std::string& code, std::string* const handler)
+		{
+			const std::filesystem::path path = m_dir / "run.sasm";
+			write_file(path, code);
+			script_t s(path.string().c_str(), &m_vm);
+			*handler = handler_at(s, "main");
+
+			double best = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < m_options.repeats; i++)
+			{
+				const auto start = clock::now();
+				for (size_t j = 0; j < m_options.iterations; j++)
+					m_vm.run(s, m_rt);
+				best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+			}
+			return best * 1e9 / m_options.iterations;
+		}
+		// assembles a long script of every straight-line instruction form (with a label and a branch back to it every so often), then
+		// deserializes the serialized version of it
+		void time_load(results* const r)
+		{
+			std::vector<std::string> lines;
+			for (const auto& [name, desc] : vm_t::get_command_descriptions())
+			{
+				bool straight = true;
+				for (const arg_type t : desc.args)
+					straight = straight && (t & (arg_type::L | arg_type::MS)) == arg_type::NONE;
+				if (straight && name != "end" && name != "ret" && name != "slp" && name != "blk")
+					for (const std::string& operands : forms(desc.args, ""))
+						lines.push_back("\t" + name + operands + "\n");
+			}
+			std::sort(lines.begin(), lines.end());
+
+			std::string code = "main:\n";
+			size_t count = 1;
+			for (size_t i = 0; count < load_lines; i++)
+			{
+				if (i % 64 == 0)
+				{
+					code += "l" + std::to_string(i) + ":\n";
+					count++;
+				}
+				code += lines[i % lines.size()];
+				if (i % 64 == 63)
+				{
+					code += "\tblt $k0, $k1, l" + std::to_string(i - 63) + "\n";
+					count++;
+				}
+				count++;
+			}
+			code += "\tend\n";
+			count++;
+
+			const std::filesystem::path source = m_dir / "load.sasm", binary = m_dir / "load.bin";
+			write_file(source, code);
+			double best = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < m_options.repeats; i++)
+			{
+				const auto start = clock::now();
+				script_t s(source.string().c_str(), &m_vm);
+				best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+				if (i == 0)
+				{
+					std::ofstream out(binary, std::ios::binary);
+					s.serialize(out);
+				}
+			}
+			r->lines_per_s = count / best;
+
+			best = std::numeric_limits<double>::max();
+			for (size_t i = 0; i < m_options.repeats; i++)
+			{
+				const auto start = clock::now();
+				delete hasl::sasm::deserialize<script_t>(binary.string().c_str(), &m_vm);
+				best = std::min(best, std::chrono::duration<double>(clock::now() - start).count());
+			}
+			r->mb_per_s = std::filesystem::file_size(binary) / best / 1e6;
+		}
+		// the handler the instruction at label was given (after quickening and verification)
+		static std::string handler_at(const script_t& s, const std::string& label)
+		{
+			for (const auto& [pc, name] : s.get_labels())
+				if (name == label && pc < s.get_instructions().size())
+					return vm_t::handler_name(s.get_instructions()[pc].handler);
+			return "";
+		}
+	};
+
+	void print(const options& o, const results& r)
+	{
+		printf("# %zu iterations x %zu, best of %zu, %s\n", o.iterations, unroll, o.repeats, o.jit ? "jit" : "interpreter");
+		printf("loop        %8.3f ns/iteration\n", r.loop_ns);
+		printf("dispatch    %8.3f ns/instruction\n", r.dispatch_ns);
+		printf("assemble    %8.0f lines/s\n", r.lines_per_s);
+		printf("deserialize %8.1f MB/s\n\n", r.mb_per_s);
+		printf("%-8s %-14s %10s  %-11s %s\n", "opcode", "handler", "ns", "per", "code");
+		for (const result& i : r.instructions)
+			printf("%-8s %-14s %10.3f  %-11s %s\n", i.opcode.c_str(), i.handler.c_str(), i.ns, i.per, i.code.c_str());
+	}
+	bool write_json(const options& o, const results& r)
+	{
+		std::ofstream out(o.output);
+		if (!out.is_open())
+		{
+			printf("Error opening output file '%s'\n", o.output.c_str());
+			return false;
+		}
+
+		char line[512];
+		snprintf(line, sizeof(line),
+			"{\n\t\"iterations\": %zu,\n\t\"unroll\": %zu,\n\t\"repeats\": %zu,\n\t\"jit\": %s,\n\t\"loop_ns\": %.4f,\n\t\"dispatch_ns\": %.4f,\n"
+			"\t\"assemble_lines_per_s\": %.0f,\n\t\"deserialize_mb_per_s\": %.3f,\n\t\"instructions\": [",
+			o.iterations, unroll, o.repeats, o.jit ? "true" : "false", r.loop_ns, r.dispatch_ns, r.lines_per_s, r.mb_per_s);
+		out << line;
+		for (size_t i = 0; i < r.instructions.size(); i++)
+		{
+			const result& cur = r.instructions[i];
+			snprintf(line, sizeof(line), "%s\n\t\t{ \"opcode\": \"%s\", \"handler\": \"%s\", \"code\": \"%s\", \"per\": \"%s\", \"ns\": %.4f }",
+				i ? "," : "", cur.opcode.c_str(), cur.handler.c_str(), escape(cur.code).c_str(), cur.per, cur.ns);
+			out << line;
+		}
+		out << "\n\t]\n}\n";
+		return true;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options o;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			o.iterations = std::max(HASL_CAST(size_t, std::stoul(argv[++i])), HASL_CAST(size_t, 1));
+		else if (arg == "-r" && i + 1 < argc)
+			o.repeats = std::max(HASL_CAST(size_t, std::stoul(argv[++i])), HASL_CAST(size_t, 1));
+		else if (arg == "-jit")
+			o.jit = true;
+		else if (arg == "-o" && i + 1 < argc)
+			o.output = argv[++i];
+		else if (arg[0] == '-')
+		{
+			printf("usage: sasm_bench [-n <iterations>] [-r <repeats>] [-jit] [-o <results.json>] [<opcode>...]\n");
+			return 1;
+		}
+		else
+			o.opcodes.push_back(arg);
+	}
+
+	const results r = bench(o).run();
+	print(o, r);
+	if (!o.output.empty() && !write_json(o, r))
+		return 1;
+	return 0;
+}
@@ -0,0 +1,108 @@
+#include "pch.h"
+#include "hasl.h"
+#include <filesystem>
+#include <map>
+#include <algorithm>
+
+// Mines a corpus of .sasm files for instruction sequences that are worth turning into superinstructions (see vm::fuse).
+// usage: sasm_mine [-n <max length>] [-top <count>] <file or directory>...
+// prints one candidate per line: "<count>\t<handler> <handler> ...", most frequent first
+
+namespace
+{
+	constexpr static size_t stack_size = 256, ram_size = 4096;
+	using vm_t = hasl::sasm::vm<stack_size, ram_size>;
+	using script_t = hasl::sasm::script<stack_size, ram_size>;
+
+	// assembling needs a vm, but nothing here is ever run
+	class mine_vm : public vm_t
+	{
+	protected:
+		hasl::sasm::scriptable* spawn(const char* s) override
+		{
+			return nullptr;
+		}
+		void process_spawn_queue(hasl::sasm::script_runtime& rt) override {}
+		bool is_key_pressed(hasl::sasm::i_t key) const override
+		{
+			return false;
+		}
+		bool is_mouse_pressed(hasl::sasm::i_t button) const override
+		{
+			return false;
+		}
+		hasl::sasm::v_t get_mouse_pos() const override
+		{
+			return {};
+		}
+		hasl::sasm::v_t get_mouse_scroll() const override
+		{
+			return {};
+		}
+	};
+
+	void collect(const std::filesystem::path& path, std::vector<std::string>* const files)
+	{
+		if (std::filesystem::is_directory(path))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+				if (entry.is_regular_file() && entry.path().extension() == ".sasm")
+					files->push_back(entry.path().string());
+		}
+		else
+			files->push_back(path.string());
+	}
+}
+
+int main(int argc, char** argv)
+{
+	size_t max_length = 3, top = 50;
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			max_length = std::max(HASL_CAST(size_t, std::stoul(argv[++i])), HASL_CAST(size_t, 2));
+		else if (arg == "-top" && i + 1 < argc)
+			top = std::stoul(argv[++i]);
+		else
+			collect(arg, &files);
+	}
+	if (files.empty())
+	{
+		printf("usage: sasm_mine [-n <max length>] [-top <count>] <file or directory>...\n");
+		return 1;
+	}
+
+	mine_vm vm;
+	std::map<std::string, size_t> counts;
+	size_t instruction_count = 0;
+	for (const auto& file : files)
+	{
+		script_t s(file.c_str(), &vm);
+		const auto& code = s.get_instructions();
+		instruction_count += code.size();
+
+		for (size_t i = 0; i < code.size(); i++)
+		{
+			std::string sequence = vm_t::handler_name(code[i].handler);
+			for (size_t n = 1; n < max_length && i + n < code.size(); n++)
+			{
+				// only the last instruction of a superinstruction may transfer control
+				if (vm_t::is_control(code[i + n - 1]))
+					break;
+				sequence += ' ';
+				sequence += vm_t::handler_name(code[i + n].handler);
+				counts[sequence]++;
+			}
+		}
+	}
+
+	std::vector<std::pair<std::string, size_t>> sorted(counts.begin(), counts.end());
+	std::sort(sorted.begin(), sorted.end(), [](const auto& a, const auto& b) { return a.second > b.second; });
+
+	printf("# %zu files, %zu instructions\n", files.size(), instruction_count);
+	for (size_t i = 0; i < std::min(top, sorted.size()); i++)
+		printf("%zu\t%s\n", sorted[i].second, sorted[i].first.c_str());
+	return 0;
+}
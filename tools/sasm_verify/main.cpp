@@ -0,0 +1,185 @@
+#include "pch.h"
+#include "hasl.h"
+#include <filesystem>
+#include <fstream>
+#include <sstream>
+#include <algorithm>
+
+// Prints what the verifier proves about .sasm files, serialized .sbc ones (see deserialize), and the scripts in .sasa archives: the most
+// stack one run can use, and which instructions it took the checks off.
+// usage: sasm_verify <file or directory>...
+// a script whose first line is "; expect <claim>..." is checked against it, and the exit code is 1 if any claim doesn't hold (a .sbc or
+// .sasa file's claims are on the first line of the .expect file next to it, and an archive's hold for every script in it). the claims are
+// "rejected" (it doesn't assemble or load), "need <slots>", "unbounded", "checked <handler>..." (every instruction with one of these
+// handlers keeps its checks), and "unchecked <handler>..." (every one loses them). handlers are named by their checked forms.
+// tools/sasm_verify/scripts has a script for each case the verifier tells apart, and files that have to be rejected
+
+namespace
+{
+	constexpr static size_t stack_size = 256, ram_size = 4096;
+	using vm_t = hasl::sasm::vm<stack_size, ram_size>;
+	using script_t = hasl::sasm::script<stack_size, ram_size>;
+	using verifier_t = hasl::sasm::verifier<stack_size, ram_size>;
+
+	void collect(const std::filesystem::path& path, std::vector<std::string>* const files)
+	{
+		if (std::filesystem::is_directory(path))
+		{
+			for (const auto& entry : std::filesystem::recursive_directory_iterator(path))
+				if (entry.is_regular_file() && (entry.path().extension() == ".sasm" || entry.path().extension() == ".sbc" ||
+					entry.path().extension() == ".sasa"))
+					files->push_back(entry.path().string());
+		}
+		else
+			files->push_back(path.string());
+	}
+	// the claims on the file's first line, or nothing if it doesn't make any
+	std::vector<std::string> read_claims(const std::string& file)
+	{
+		std::ifstream in(file);
+		std::string line;
+		std::getline(in, line);
+		const std::string prefix = "; expect ";
+		if (line.compare(0, prefix.size(), prefix) != 0)
+			return {};
+
+		std::istringstream words(line.substr(prefix.size()));
+		std::vector<std::string> claims;
+		for (std::string word; words >> word;)
+			claims.push_back(word);
+		return claims;
+	}
+	// whether every instruction whose checked handler is name has its checks on (or off), printing why if not
+	bool holds(const script_t& s, const std::string& name, bool on)
+	{
+		size_t found = 0;
+		for (const hasl::sasm::args& a : s.get_instructions())
+		{
+			if (name != vm_t::handler_name(vm_t::checked(a.handler)))
+				continue;
+			found++;
+			if ((vm_t::checked(a.handler) == a.handler) != on)
+			{
+				printf("  %s is %s\n", name.c_str(), on ? "unchecked" : "checked");
+				return false;
+			}
+		}
+		if (found == 0)
+			printf("  no %s\n", name.c_str());
+		return found != 0;
+	}
+	// prints what the verifier proved about loaded (nullptr if it was rejected) and checks the claims against it, returns whether they hold
+	bool check(const std::string& label, const script_t* const loaded, const std::vector<std::string>& claims)
+	{
+		const bool rejectable = std::find(claims.begin(), claims.end(), "rejected") != claims.end();
+		if (!loaded || !loaded->is_assembled())
+		{
+			printf("%s: rejected\n", label.c_str());
+			if (rejectable)
+				printf("  ok\n");
+			return rejectable;
+		}
+		const script_t& s = *loaded;
+
+		size_t removed = 0;
+		for (const hasl::sasm::args& a : s.get_instructions())
+			removed += vm_t::checked(a.handler) != a.handler;
+		const size_t need = s.get_stack_need();
+		if (need == verifier_t::s_unbounded)
+			printf("%s: unbounded, %zu of %zu instructions unchecked\n", label.c_str(), removed, s.get_instructions().size());
+		else
+			printf("%s: need %zu, %zu of %zu instructions unchecked\n", label.c_str(), need, removed, s.get_instructions().size());
+
+		bool ok = true;
+		// whether the words are handlers, and which list they're in
+		bool listing = false, on = false;
+		for (size_t i = 0; i < claims.size(); i++)
+		{
+			if (claims[i] == "rejected")
+			{
+				printf("  expected rejected\n");
+				ok = false;
+				listing = false;
+			}
+			else if (claims[i] == "need" && i + 1 < claims.size())
+			{
+				const size_t expected = std::stoul(claims[++i]);
+				if (need != expected)
+				{
+					printf("  expected need %zu\n", expected);
+					ok = false;
+				}
+				listing = false;
+			}
+			else if (claims[i] == "unbounded")
+			{
+				if (need != verifier_t::s_unbounded)
+				{
+					printf("  expected unbounded\n");
+					ok = false;
+				}
+				listing = false;
+			}
+			else if (claims[i] == "checked" || claims[i] == "unchecked")
+			{
+				listing = true;
+				on = claims[i] == "checked";
+			}
+			else if (listing)
+				ok = holds(s, claims[i], on) && ok;
+			else
+			{
+				printf("  unknown claim '%s'\n", claims[i].c_str());
+				ok = false;
+			}
+		}
+		if (!claims.empty())
+			printf("  %s\n", ok ? "ok" : "FAILED");
+		return ok;
+	}
+}
+
+int main(int argc, char** argv)
+{
+	std::vector<std::string> files;
+	for (int i = 1; i < argc; i++)
+		collect(argv[i], &files);
+	std::sort(files.begin(), files.end());
+	if (files.empty())
+	{
+		printf("usage: sasm_verify <file or directory>...\n");
+		return 1;
+	}
+
+	size_t failed = 0;
+	for (const auto& file : files)
+	{
+		const std::filesystem::path path = file;
+		const bool packed = path.extension() == ".sasa", bytecode = packed || path.extension() == ".sbc";
+		const std::vector<std::string> claims = read_claims(bytecode ? std::filesystem::path(path).replace_extension(".expect").string() : file);
+
+		// the verifier runs when the script is assembled or loaded
+		if (packed)
+		{
+			const hasl::sasm::archive a(file.c_str());
+			if (!a.valid())
+				failed += !check(file, nullptr, claims);
+			for (size_t i = 0; a.valid() && i < a.size(); i++)
+			{
+				const std::unique_ptr<script_t> loaded(a.load<script_t>(a.name(i), nullptr));
+				failed += !check(file + ":" + a.name(i), loaded.get(), claims);
+			}
+		}
+		else if (bytecode)
+		{
+			const std::unique_ptr<script_t> loaded(hasl::sasm::deserialize<script_t>(file.c_str(), nullptr));
+			failed += !check(file, loaded.get(), claims);
+		}
+		else
+		{
+			const script_t loaded(file.c_str(), nullptr);
+			failed += !check(file, &loaded, claims);
+		}
+	}
+	return failed == 0 ? 0 : 1;
+}
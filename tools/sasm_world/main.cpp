@@ -0,0 +1,390 @@
+#include "pch.h"
+#include "hasl.h"
+#include <filesystem>
+#include <random>
+#ifdef __linux__
+#include <unistd.h>
+#endif
+
+// Simulates a world of scripted entities with no engine behind it, to measure how the vm holds up end to end: every .sasm file in the
+// scripts directory is an archetype, entities of each are spread over the world and run by a scheduler each tick, and a simulated player
+// presses keys and moves the mouse on a fixed timeline.
+// usage: sasm_world [-n <entities>] [-t <ticks>] [-budget <instructions>] [-s <scripts directory>]
+// prints ticks/s, the p50 and p99 time a tick took, and the memory each entity takes (resident memory on Linux, an estimate elsewhere)
+
+namespace
+{
+	constexpr static size_t stack_size = 64, ram_size = 4096;
+	// length of a tick, in ms (what scripts' slp times are in)
+	constexpr static float tick_ms = 16.f;
+	constexpr static float world_size = 1000.f;
+	using vm_t = hasl::sasm::vm<stack_size, ram_size>;
+	using script_t = hasl::sasm::script<stack_size, ram_size>;
+	using program_t = hasl::sasm::program<stack_size, ram_size>;
+	using scheduler_t = hasl::sasm::scheduler<stack_size, ram_size>;
+	using hasl::sasm::i_t;
+	using hasl::sasm::v_t;
+	using clock = std::chrono::steady_clock;
+
+	struct options
+	{
+		size_t entities = 10000, ticks = 600, budget = 0;
+		std::filesystem::path scripts = std::filesystem::path(__FILE__).parent_path() / "scripts";
+	};
+	// how many in 100 of the entities placed at the start are of each archetype. the others (sparks) only come from spn
+	const std::vector<std::pair<std::string, size_t>> mix = { { "npc_patrol", 60 }, { "npc_chase", 25 }, { "item", 10 }, { "cutscene", 5 } };
+
+	class entity : public hasl::sasm::scriptable
+	{
+	public:
+		entity(const v_t& pos, const v_t& dims, float speed) :
+			scriptable(s_states, "idle"),
+			rt{ 0.f, 0.f, this, {} },
+			m_dims(dims)
+		{
+			m_pos = pos;
+			m_vel = {};
+			m_speed = speed;
+		}
+		v_t get_dims() const override
+		{
+			return m_dims;
+		}
+	public:
+		hasl::sasm::script_runtime rt;
+	private:
+		// the states scripts switch between with oss (nothing is drawn, so there's nothing to keep for them)
+		static inline const std::unordered_map<std::string, void*> s_states = { { "idle", nullptr }, { "walk", nullptr }, { "talk", nullptr } };
+		v_t m_dims;
+	};
+
+	class world;
+	// the engine hooks, answered by the world
+	class world_vm : public vm_t
+	{
+	public:
+		world_vm(world* const w) :
+			m_world(w)
+		{}
+	protected:
+		hasl::sasm::scriptable* spawn(const char* s) override;
+		// spawned entities are added by world::tick once every archetype has run
+		void process_spawn_queue(hasl::sasm::script_runtime&) override {}
+		bool is_key_pressed(i_t key) const override;
+		bool is_mouse_pressed(i_t button) const override;
+		v_t get_mouse_pos() const override;
+		v_t get_mouse_scroll() const override;
+	private:
+		world* const m_world;
+	};
+
+	// one script and the entities that run it. each archetype has its own vm, since the assembler lays every script's string literals out
+	// down from the top of RAM
+	struct archetype
+	{
+		std::string name;
+		std::unique_ptr<world_vm> vm;
+		std::unique_ptr<scheduler_t> scheduler;
+		// the assembled (and fused) program, shared by every entity's script
+		std::shared_ptr<program_t> program;
+		v_t dims;
+		float speed = 0.f;
+		std::unordered_map<scheduler_t::handle, std::unique_ptr<entity>> live;
+	};
+	// an entity spawned during a tick, added to its scheduler once the tick is over
+	struct pending
+	{
+		archetype* a;
+		std::unique_ptr<entity> e;
+		std::unique_ptr<script_t> s;
+	};
+	struct stats
+	{
+		uint64_t runs = 0, spawned = 0, despawned = 0;
+		// wall time of each tick, in seconds
+		std::vector<double> ticks;
+	};
+
+	class world
+	{
+	public:
+		world(const options& o) :
+			m_options(o),
+			m_tick(0),
+			m_random(1)
+		{}
+		HASL_DCM(world);
+	public:
+		// assembles every script in the directory, returns false if there's one that doesn't or a placed archetype is missing
+		bool load()
+		{
+			std::vector<std::filesystem::path> files;
+			if (std::filesystem::is_directory(m_options.scripts))
+				for (const auto& entry : std::filesystem::directory_iterator(m_options.scripts))
+					if (entry.is_regular_file() && entry.path().extension() == ".sasm")
+						files.push_back(entry.path());
+			std::sort(files.begin(), files.end());
+
+			for (const std::filesystem::path& path : files)
+			{
+				auto a = std::make_unique<archetype>();
+				a->name = path.stem().string();
+				a->vm = std::make_unique<world_vm>(this);
+				a->vm->set_instruction_budget(m_options.budget);
+				a->scheduler = std::make_unique<scheduler_t>(a->vm.get(), 1.f);
+
+				script_t prototype(path.string().c_str(), a->vm.get());
+				if (prototype.get_instructions().empty())
+				{
+					printf("Error assembling '%s'\n", path.string().c_str());
+					return false;
+				}
+				vm_t::fuse(prototype);
+				a->program = prototype.get_program();
+				a->dims = a->name == "spark" ? v_t{ 2.f, 2.f } : v_t{ 16.f, 32.f };
+				a->speed = a->name == "npc_chase" ? 3.f : 1.f;
+				m_archetypes.push_back(std::move(a));
+			}
+
+			for (const auto& [name, share] : mix)
+			{
+				if (!find(name))
+				{
+					printf("Error: no '%s.sasm' in '%s'\n", name.c_str(), m_options.scripts.string().c_str());
+					return false;
+				}
+			}
+			return true;
+		}
+		// places the world's entities, mixed as given by mix
+		void populate()
+		{
+			std::uniform_real_distribution<float> coord(0.f, world_size);
+			for (size_t i = 0; i < m_options.entities; i++)
+			{
+				size_t slot = i % 100;
+				for (const auto& [name, share] : mix)
+				{
+					if (slot < share)
+					{
+						archetype* const a = find(name);
+						const v_t pos = { coord(m_random), coord(m_random) };
+						add(a, create(a, pos));
+						break;
+					}
+					slot -= share;
+				}
+			}
+		}
+		// runs every archetype's scripts for one tick, then takes out the entities that asked to be removed ($flags 1) and puts in the ones
+		// that were spawned
+		void tick(stats* const st)
+		{
+			const float time = m_tick * tick_ms;
+			for (const std::unique_ptr<archetype>& a : m_archetypes)
+			{
+				std::vector<scheduler_t::handle> removed;
+				for (const auto& [h, flag] : a->scheduler->tick(time, tick_ms))
+				{
+					st->runs++;
+					if (flag == 1)
+					{
+						removed.push_back(h);
+						continue;
+					}
+					// what a script spawned can only be reached from the run that spawned it (unless it was preempted before it got to it)
+					if (!a->scheduler->get(h)->get_context().preempted)
+						a->live.at(h)->rt.env.clear();
+				}
+				for (const scheduler_t::handle h : removed)
+				{
+					a->scheduler->remove(h);
+					a->live.erase(h);
+				}
+				st->despawned += removed.size();
+			}
+
+			st->spawned += m_pending.size();
+			for (pending& p : m_pending)
+				p.a->live.emplace(p.a->scheduler->add(std::move(p.s), &p.e->rt), std::move(p.e));
+			m_pending.clear();
+			m_tick++;
+		}
+		size_t live() const
+		{
+			size_t count = 0;
+			for (const std::unique_ptr<archetype>& a : m_archetypes)
+				count += a->live.size();
+			return count;
+		}
+		// bytes an entity of a takes at least: the entity and its script, and its share of the program every entity of a runs
+		static size_t estimate(const archetype& a)
+		{
+			const size_t shared = sizeof(program_t) + a.program->get_instructions().size_bytes() + a.program->get_data().bytes.size();
+			return sizeof(entity) + sizeof(script_t) + shared / std::max(a.live.size(), HASL_CAST(size_t, 1));
+		}
+		const std::vector<std::unique_ptr<archetype>>& get_archetypes() const
+		{
+			return m_archetypes;
+		}
+	public:
+		// the hooks, which play back a fixed timeline: key 1 is tapped every 90 ticks, the left mouse button is held for half of every 240,
+		// the mouse circles the middle of the world, and the wheel rocks back and forth
+		entity* spawn(const char* name)
+		{
+			archetype* const a = find(name);
+			HASL_ASSERT(a, "Spawned an archetype with no script");
+			m_pending.push_back({ a, create(a, {}), nullptr });
+			m_pending.back().s = std::make_unique<script_t>(a->program);
+			return m_pending.back().e.get();
+		}
+		bool is_key_pressed(i_t key) const
+		{
+			return key == 1 && m_tick % 90 < 2;
+		}
+		bool is_mouse_pressed(i_t button) const
+		{
+			return button == 0 && m_tick % 240 < 120;
+		}
+		v_t get_mouse_pos() const
+		{
+			const float angle = m_tick * .02f;
+			return { world_size / 2 + std::cos(angle) * world_size / 3, world_size / 2 + std::sin(angle) * world_size / 3 };
+		}
+		v_t get_mouse_scroll() const
+		{
+			return { 0.f, m_tick % 2 ? 1.f : -1.f };
+		}
+	private:
+		options m_options;
+		size_t m_tick;
+		std::mt19937 m_random;
+		std::vector<std::unique_ptr<archetype>> m_archetypes;
+		std::vector<pending> m_pending;
+	private:
+		archetype* find(const std::string& name) const
+		{
+			for (const std::unique_ptr<archetype>& a : m_archetypes)
+				if (a->name == name)
+					return a.get();
+			return nullptr;
+		}
+		static std::unique_ptr<entity> create(const archetype* a, const v_t& pos)
+		{
+			return std::make_unique<entity>(pos, a->dims, a->speed);
+		}
+		void add(archetype* const a, std::unique_ptr<entity> e)
+		{
+			auto s = std::make_unique<script_t>(a->program);
+			const scheduler_t::handle h = a->scheduler->add(std::move(s), &e->rt);
+			a->live.emplace(h, std::move(e));
+		}
+	};
+
+	hasl::sasm::scriptable* world_vm::spawn(const char* s)
+	{
+		return m_world->spawn(s);
+	}
+	bool world_vm::is_key_pressed(i_t key) const
+	{
+		return m_world->is_key_pressed(key);
+	}
+	bool world_vm::is_mouse_pressed(i_t button) const
+	{
+		return m_world->is_mouse_pressed(button);
+	}
+	v_t world_vm::get_mouse_pos() const
+	{
+		return m_world->get_mouse_pos();
+	}
+	v_t world_vm::get_mouse_scroll() const
+	{
+		return m_world->get_mouse_scroll();
+	}
+
+	// bytes of the process that are in memory, or 0 if that can't be read here
+	size_t resident()
+	{
+#ifdef __linux__
+		std::ifstream statm("/proc/self/statm");
+		size_t total = 0, pages = 0;
+		if (statm >> total >> pages)
+			return pages * HASL_CAST(size_t, sysconf(_SC_PAGESIZE));
+#endif
+		return 0;
+	}
+	double percentile(std::vector<double> v, double p)
+	{
+		if (v.empty())
+			return 0;
+		std::sort(v.begin(), v.end());
+		return v[std::min(HASL_CAST(size_t, p * v.size()), v.size() - 1)];
+	}
+}
+
+int main(int argc, char** argv)
+{
+	options o;
+	for (int i = 1; i < argc; i++)
+	{
+		const std::string arg = argv[i];
+		if (arg == "-n" && i + 1 < argc)
+			o.entities = std::stoul(argv[++i]);
+		else if (arg == "-t" && i + 1 < argc)
+			o.ticks = std::max(HASL_CAST(size_t, std::stoul(argv[++i])), HASL_CAST(size_t, 1));
+		else if (arg == "-budget" && i + 1 < argc)
+			o.budget = std::stoul(argv[++i]);
+		else if (arg == "-s" && i + 1 < argc)
+			o.scripts = argv[++i];
+		else
+		{
+			printf("usage: sasm_world [-n <entities>] [-t <ticks>] [-budget <instructions>] [-s <scripts directory>]\n");
+			return 1;
+		}
+	}
+
+	world w(o);
+	if (!w.load())
+		return 1;
+
+	const size_t before = resident();
+	w.populate();
+	const size_t after = resident();
+
+	stats st;
+	st.ticks.reserve(o.ticks);
+	const auto start = clock::now();
+	for (size_t i = 0; i < o.ticks; i++)
+	{
+		const auto tick_start = clock::now();
+		w.tick(&st);
+		st.ticks.push_back(std::chrono::duration<double>(clock::now() - tick_start).count());
+	}
+	const double seconds = std::chrono::duration<double>(clock::now() - start).count();
+
+	printf("# %zu entities, %zu ticks of %.0f ms, %s\n", o.entities, o.ticks, tick_ms,
+		o.budget ? ("budget " + std::to_string(o.budget)).c_str() : "no budget");
+	printf("%-12s %8s %8s %10s\n", "archetype", "live", "code", "bytes");
+	for (const std::unique_ptr<archetype>& a : w.get_archetypes())
+		printf("%-12s %8zu %8zu %10zu\n", a->name.c_str(), a->live.size(), a->program->get_instructions().size(), world::estimate(*a));
+	printf("\nticks/s     %10.1f\n", o.ticks / seconds);
+	printf("tick p50    %10.3f ms\n", percentile(st.ticks, .5) * 1000);
+	printf("tick p99    %10.3f ms\n", percentile(st.ticks, .99) * 1000);
+	printf("runs/s      %10.0f\n", st.runs / seconds);
+	printf("runs        %10llu\n", HASL_CAST(unsigned long long, st.runs));
+	printf("spawned     %10llu\n", HASL_CAST(unsigned long long, st.spawned));
+	printf("despawned   %10llu\n", HASL_CAST(unsigned long long, st.despawned));
+	printf("live        %10zu\n", w.live());
+	if (after > before && o.entities)
+		printf("memory      %10.0f bytes/entity (resident)\n", HASL_CAST(double, after - before) / o.entities);
+	else
+	{
+		size_t bytes = 0;
+		for (const auto& [name, share] : mix)
+			for (const std::unique_ptr<archetype>& a : w.get_archetypes())
+				if (a->name == name)
+					bytes += share * world::estimate(*a);
+		printf("memory      %10.0f bytes/entity (estimated)\n", bytes / 100.);
+	}
+	return 0;
+}